@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SDL.h"
+#include "IndexedRenderer.h"
+#include "Machine.h"
+
+/**
+ * Times the emulator's hot paths in isolation (bus accesses, rom decoding, rasterization) and end to end (frames of
+ * the attract mode). Every result is a rate, so higher is always better.
+ */
+struct Bench {
+    struct Result {
+        std::string name;
+        std::string unit;
+        double value;
+    };
+
+    // a timed run must take at least this long; the best of several runs is kept
+    static constexpr std::chrono::duration<double> minRunTime {0.1};
+    static constexpr int runs {5};
+
+    // frames of the attract mode run from power on
+    static constexpr int attractFrames {600};
+
+    /**
+     * Times a benchmark body, doubling the calls per run until a run takes minRunTime.
+     * @param body the code to time
+     * @param ops how many operations one call of body performs
+     * @return the best operations per second of all runs
+     */
+    template<class F>
+    static double measure(F&& body, const double ops)
+    {
+        double best {0.0};
+        int calls {1};
+        for (int run {0}; run != runs;) {
+            const auto begin {std::chrono::steady_clock::now()};
+            for (int i {0}; i != calls; ++i)
+                body();
+            const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - begin};
+
+            if (elapsed < minRunTime) {
+                calls *= 2;
+                continue;
+            }
+            best = std::max(best, ops * calls / elapsed.count());
+            ++run;
+        }
+        return best;
+    }
+
+    /**
+     * Runs every benchmark.
+     * @param dir the rom directory
+     * @param results where to append the results
+     * @return true if the roms could be loaded; false otherwise
+     */
+    static bool run(const std::string& dir, std::vector<Result>& results)
+    {
+        const std::shared_ptr<const Assets> assets {Assets::load(dir)};
+        if (assets == nullptr) return false;
+
+        // a deterministic stream of pseudo-random numbers
+        std::uint32_t seed {0x12345678};
+        const auto next {[&seed] { seed = seed * 1664525U + 1013904223U; return seed >> 8; }};
+
+        // bus: addresses weighted roughly like the game's own traffic (mostly rom fetches, then ram, few registers)
+        Pacman board {assets, dipswitch, true};
+        std::vector<std::uint16_t> reads(0x10000), writes(0x10000);
+        for (std::uint16_t& addr : reads) {
+            const std::uint32_t r {next() % 100};
+            addr = r < 70 ? next() % 0x4000 : r < 95 ? 0x4000 + next() % 0x1000 : 0x5000 + next() % 0xC0;
+        }
+        for (std::uint16_t& addr : writes) {
+            const std::uint32_t r {next() % 100};
+            addr = r < 90 ? 0x4000 + next() % 0x1000 : 0x5000 + next() % 0x100;
+        }
+
+        std::uint32_t sum {0};
+        results.push_back({"read8_mix", "accesses/s", measure([&] {
+            for (const std::uint16_t addr : reads)
+                sum += board.read8(addr);
+        }, static_cast<double>(reads.size()))});
+        results.push_back({"write8_mix", "accesses/s", measure([&] {
+            for (const std::uint16_t addr : writes)
+                board.write8(addr, addr & 0xFF);
+        }, static_cast<double>(writes.size()))});
+
+        // decoding: every strip of the tile and sprite roms, as decodeAssets does
+        std::vector<std::uint8_t> rom(0x1000);
+        for (std::uint8_t& byte : rom)
+            byte = next() & 0xFF;
+        Assets::Tile tile {};
+        Assets::Sprite sprite {};
+        results.push_back({"decode_strip", "strips/s", measure([&] {
+            for (int i {0}; i != 256; ++i) {
+                decodeStrip(rom.data(), tile, i, 0, 8, 0, 1);
+                decodeStrip(rom.data(), tile, i, 1, 8, 0, 0);
+                sum += tile[i & 63];
+            }
+            for (int i {0}; i != 64; ++i) {
+                for (int strip {0}; strip != 8; ++strip)
+                    decodeStrip(rom.data(), sprite, i, strip, 16, strip < 4, (strip + 3) & 3);
+                sum += sprite[i];
+            }
+        }, 256 * 2 + 64 * 8)});
+        // the whole decode from rom images already in memory (it doesn't depend on the bytes)
+        auto roms {std::make_unique<RomImages>()};
+        auto* romBytes {reinterpret_cast<std::uint8_t*>(roms.get())};
+        for (std::size_t i {0}; i != sizeof(RomImages); ++i)
+            romBytes[i] = next() & 0xFF;
+        auto decoded {std::make_unique<DecodedAssets>()};
+        results.push_back({"decode_assets", "decodes/s", measure([&] {
+            decodeAssets(*roms, *decoded);
+            sum += decoded->tiles[0][0];
+        }, 1)});
+
+        // reading the rom files and decoding them (never the asset pack or the embedded roms)
+        results.push_back({"load_rom_files", "loads/s", measure([&] {
+            sum += Assets::loadRoms(dir) != nullptr;
+        }, 1)});
+
+        // rasterization into the frame buffer (headless: nothing is uploaded)
+        for (int addr {0x4000}; addr != 0x5000; ++addr)
+            board.write8(addr, next() & 0xFF);
+        for (int addr {0x5060}; addr != 0x5070; ++addr)
+            board.write8(addr, 32 + next() % 160);
+        results.push_back({"draw_band", "rows/s", measure([&] {
+            const std::uint8_t noSprites[8] {};
+            for (int ty {0}; ty != Pacman::screenHeight / 8; ++ty)
+                board.drawBand(ty, (1U << Pacman::screenWidth / 8) - 1, nullptr, noSprites);
+        }, Pacman::screenHeight / 8)});
+        results.push_back({"render_sprites", "frames/s", measure([&] {
+            // every sprite moves, nothing else changes: only the tiles under them are redrawn
+            for (std::uint8_t& pos : board.spritePos)
+                ++pos;
+            board.render();
+        }, 1)});
+        results.push_back({"render_full", "frames/s", measure([&] {
+            board.fullRedraw = true;
+            board.render();
+        }, 1)});
+
+        // one byte per pixel, straight from the video state
+        Pacman::Video video {};
+        board.capture(video);
+        const IndexedRenderer indexed {*assets, IndexedRenderer::paletteIndex};
+        const IndexedRenderer gray4x {*assets, IndexedRenderer::grayscale, 4};
+        std::vector<std::uint8_t> pixels(Pacman::screenWidth * Pacman::screenHeight);
+        results.push_back({"render_indexed", "frames/s", measure([&] {
+            indexed.render(video, pixels.data(), indexed.width());
+            sum += pixels[0];
+        }, 1)});
+        results.push_back({"render_gray_4x", "frames/s", measure([&] {
+            gray4x.render(video, pixels.data(), gray4x.width());
+            sum += pixels[0];
+        }, 1)});
+
+        // what a bot reads instead of a rendered frame
+        results.push_back({"observe", "states/s", measure([&] {
+            GameState::Observation observation {};
+            board.state().observe(observation);
+            sum += observation.score + observation.dots[0];
+        }, 1)});
+
+        // post-processing of the rendered frame, on every core
+        for (int kind {Filter::scale2x}; kind != Filter::kinds; ++kind) {
+            Filter filter {static_cast<Filter::Kind>(kind), Pacman::screenWidth, Pacman::screenHeight, std::thread::hardware_concurrency()};
+            std::string name {std::string{"filter_"} + Filter::name(filter.kind())};
+            std::transform(name.begin(), name.end(), name.begin(), [](const char c) { return static_cast<char>(std::tolower(c)); });
+            results.push_back({name, "frames/s", measure([&] {
+                sum += filter.apply(board.frame())[0];
+            }, 1)});
+        }
+
+        // end to end: a fixed stretch of the attract mode from power on, rendered
+        results.push_back({"attract_frames", "frames/s", measure([&] {
+            Machine machine {assets, dipswitch};
+            machine.runFrames(attractFrames);
+            sum += machine.pacman.memory()[0x800];
+        }, attractFrames)});
+
+        sink = sum;
+        return true;
+    }
+
+    /**
+     * Writes results as JSON.
+     * @param file where to write
+     * @param results the results
+     */
+    static void write(std::FILE* file, const std::vector<Result>& results)
+    {
+        std::fprintf(file, "{\n  \"benchmarks\": [\n");
+        for (std::size_t i {0}; i != results.size(); ++i) {
+            std::fprintf(file, "    {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.1f}%s\n", results[i].name.c_str(),
+                         results[i].unit.c_str(), results[i].value, i + 1 != results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+    }
+
+    /**
+     * Reads results written by write.
+     * @param path the JSON file
+     * @param results where to put each benchmark's value by name
+     * @return true if the file could be opened; false otherwise
+     */
+    static bool read(const std::string& path, std::map<std::string, double>& results)
+    {
+        std::ifstream file {path};
+        if (!file.is_open()) {
+            SDL_Log("error: can't open file '%s'.\n", path.c_str());
+            return false;
+        }
+        const std::string text {std::istreambuf_iterator<char>{file}, {}};
+
+        for (std::size_t pos {text.find("\"name\"")}; pos != std::string::npos; pos = text.find("\"name\"", pos + 1)) {
+            const std::size_t begin {text.find('"', text.find(':', pos)) + 1};
+            const std::size_t end {text.find('"', begin)};
+            const std::size_t value {text.find("\"value\"", end)};
+            if (value == std::string::npos) break;
+            results[text.substr(begin, end - begin)] = std::strtod(text.c_str() + text.find(':', value) + 1, nullptr);
+        }
+        return true;
+    }
+
+    /**
+     * Compares results against a baseline.
+     * @param results this run's results
+     * @param baseline the baseline's values by name
+     * @param tolerance the largest slowdown not reported as a regression, in percent
+     * @return true if no benchmark regressed; false otherwise
+     */
+    static bool compare(const std::vector<Result>& results, const std::map<std::string, double>& baseline, const double tolerance)
+    {
+        bool ok {true};
+        SDL_Log("%-16s %16s %16s %9s\n", "benchmark", "baseline", "current", "change");
+        for (const Result& result : results) {
+            const auto it {baseline.find(result.name)};
+            if (it == baseline.end() or it->second <= 0.0) {
+                SDL_Log("%-16s %16s %16.0f %9s\n", result.name.c_str(), "-", result.value, "new");
+                continue;
+            }
+            const double change {(result.value / it->second - 1.0) * 100.0};
+            const bool regressed {change < -tolerance};
+            ok &= !regressed;
+            SDL_Log("%-16s %16.0f %16.0f %+8.1f%%%s\n", result.name.c_str(), it->second, result.value, change,
+                    regressed ? "  REGRESSED" : "");
+        }
+        return ok;
+    }
+
+    static constexpr std::uint8_t dipswitch {0b11001001};
+    static inline volatile std::uint32_t sink {}; // keeps the timed work from being optimized away
+};
+
+int main(int argc, char** argv)
+{
+    using namespace std::string_view_literals;
+
+    std::string dir {"roms/"}, outPath, baselinePath;
+    double tolerance {10.0};
+
+    for (int i {1}; i < argc; ++i) {
+        bool hasNext {i + 1 != argc};
+        if (!hasNext) break;
+
+        std::string setting {argv[i + 1]};
+        if (argv[i] == "-roms"sv) {
+            dir = setting;
+            if (dir.back() != '/') dir += '/';
+        } else if (argv[i] == "-out"sv) {
+            outPath = setting;
+        } else if (argv[i] == "-baseline"sv) {
+            baselinePath = setting;
+        } else if (argv[i] == "-tolerance"sv) {
+            try {
+                tolerance = std::stod(setting);
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read number for '-tolerance' parameter, using default=10%%.\n");
+            }
+        } else {
+            SDL_Log("Unrecognized command line argument '%s'.\nAvailable parameters are:\n\t-roms <dir>\n\t-out <file>\n\t-baseline <file>\n\t-tolerance <percent>\n\n", argv[i]);
+        }
+        ++i;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty() and !Bench::read(baselinePath, baseline)) return 1;
+
+    std::vector<Bench::Result> results;
+    if (!Bench::run(dir, results)) return 1;
+
+    if (outPath.empty()) {
+        Bench::write(stdout, results);
+    } else {
+        std::FILE* file {std::fopen(outPath.c_str(), "w")};
+        if (file == nullptr) {
+            SDL_Log("error: can't open file '%s'.\n", outPath.c_str());
+            return 1;
+        }
+        Bench::write(file, results);
+        std::fclose(file);
+    }
+
+    if (!baselinePath.empty() and !Bench::compare(results, baseline, tolerance)) return 1;
+    return 0;
+}
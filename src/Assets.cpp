@@ -0,0 +1,185 @@
+#include "Assets.h"
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include "SDL.h"
+#include "Hash.h"
+
+#ifndef PACMAN_EMBED_ROMS
+#define PACMAN_EMBED_ROMS 0
+#endif
+
+#if PACMAN_EMBED_ROMS
+#include "EmbeddedRoms.h"
+
+// decoded by the compiler: startup only copies it
+static constexpr DecodedAssets embeddedAssets {[] {
+    DecodedAssets assets {};
+    decodeAssets(embeddedRoms, assets);
+    return assets;
+}()};
+#endif
+
+static_assert(std::is_trivially_copyable_v<DecodedAssets>, "asset packs hold the decoded data as raw bytes");
+
+/**
+ * Asset pack layout: this header, then the raw bytes of DecodedAssets. Packs are only read by builds with the same
+ * layout (same size, same endianness), which the size field and the hash guard against.
+ */
+struct PackHeader {
+    static constexpr std::uint32_t version {3};
+
+    char magic[8] {'P', 'A', 'C', 'A', 'S', 'S', 'E', 'T'};
+    std::uint32_t packVersion {version};
+    std::uint32_t size {sizeof(DecodedAssets)};
+    std::uint64_t romHash {}; // hash64 of the RomImages the data was decoded from
+    std::uint64_t hash {}; // hash64 of the data
+};
+
+/**
+ * For loading a binary ROM file.
+ * @param array a pointer to where to dump the file's contents
+ * @param path path to the file
+ * @param addr base address to start reading the file from
+ * @param sz size of the array
+ * @return true if there were no errors opening/reading the file; false otherwise
+ */
+bool load(std::uint8_t* array, const std::string& path, const int addr, const int sz)
+{
+    std::ifstream file {path, std::ios::binary};
+
+    if (!file.is_open()) {
+        SDL_Log("error: can't open file '%s'.\n", path.c_str());
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(array) + addr, sz);
+
+    if (file.bad()) {
+        SDL_Log("error [errno=%d]: failed when reading file '%s'.\n", errno, path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Reads the individual rom files.
+ * @param roms where to put the images
+ * @param dir the rom file's parent directory
+ * @return true if every rom but the optional sound prom could be read; false otherwise
+ */
+static bool readRoms(RomImages& roms, const std::string& dir)
+{
+    // load the program, color, palette, tile and sprite roms
+    if (!(::load(roms.program, dir + "pacman.6e", 0, 0x1000)
+            and ::load(roms.program, dir + "pacman.6f", 0x1000, 0x1000)
+            and ::load(roms.program, dir + "pacman.6h", 0x2000, 0x1000)
+            and ::load(roms.program, dir + "pacman.6j", 0x3000, 0x1000)
+            and ::load(roms.color, dir + "82s123.7f", 0, 0x20)
+            and ::load(roms.palette, dir + "82s126.4a", 0, 0x100)
+            and ::load(roms.tile, dir + "pacman.5e", 0, 0x1000)
+            and ::load(roms.sprite, dir + "pacman.5f", 0, 0x1000)))
+        return false;
+
+    // the sound prom is optional: without it the game just runs silent
+    if (!::load(roms.sound, dir + "82s126.1m", 0, sizeof(roms.sound)))
+        SDL_Log("warning: no sound prom, sound is disabled.\n");
+
+    return true;
+}
+
+std::shared_ptr<const Assets> Assets::load(const std::string& dir)
+{
+#if PACMAN_EMBED_ROMS
+    // one copy of the compile-time data (and one blit cache) for every board in the process
+    static const std::shared_ptr<const Assets> embedded {[] {
+        auto assets {std::make_shared<Assets>()};
+        static_cast<DecodedAssets&>(*assets) = embeddedAssets;
+        assets->romHash = hash64(&embeddedRoms, sizeof(embeddedRoms));
+        assets->cache = std::make_unique<BlitCache>(*assets);
+        return assets;
+    }()};
+    return embedded;
+#else
+    auto roms {std::make_unique<RomImages>()};
+    if (!readRoms(*roms, dir)) return nullptr;
+
+    // the pack only saves the decoding, so it is used only if it was made from these very roms
+    const std::uint64_t romHash {hash64(roms.get(), sizeof(RomImages))};
+    if (std::shared_ptr<const Assets> assets {loadPack(dir + "assets.pack", romHash)})
+        return assets;
+
+    auto assets {std::make_shared<Assets>()};
+    decodeAssets(*roms, *assets);
+    assets->romHash = romHash;
+    assets->cache = std::make_unique<BlitCache>(*assets);
+    return assets;
+#endif
+}
+
+std::shared_ptr<const Assets> Assets::loadRoms(const std::string& dir)
+{
+    auto roms {std::make_unique<RomImages>()};
+    if (!readRoms(*roms, dir)) return nullptr;
+
+    auto assets {std::make_shared<Assets>()};
+    decodeAssets(*roms, *assets);
+    assets->romHash = hash64(roms.get(), sizeof(RomImages));
+    assets->cache = std::make_unique<BlitCache>(*assets);
+    return assets;
+}
+
+std::shared_ptr<const Assets> Assets::loadPack(const std::string& path, const std::uint64_t romHash)
+{
+    std::ifstream file {path, std::ios::binary};
+    if (!file.is_open()) return nullptr;
+
+    PackHeader header {};
+    const PackHeader expected {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file or std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+            or header.packVersion != expected.packVersion or header.size != expected.size) {
+        SDL_Log("warning: asset pack '%s' is corrupt or from another build, ignoring it.\n", path.c_str());
+        return nullptr;
+    }
+    if (header.romHash != romHash) {
+        SDL_Log("warning: asset pack '%s' was made from other roms, ignoring it.\n", path.c_str());
+        return nullptr;
+    }
+
+    // read straight into the assets: the data is used as is, so there is nothing to gain from mapping the file
+    auto assets {std::make_shared<Assets>()};
+    DecodedAssets& data {*assets};
+    file.read(reinterpret_cast<char*>(&data), sizeof(data));
+    if (!file or file.peek() != std::ifstream::traits_type::eof() or header.hash != hash64(&data, sizeof(data))) {
+        SDL_Log("warning: asset pack '%s' is corrupt or from another build, ignoring it.\n", path.c_str());
+        return nullptr;
+    }
+
+    assets->romHash = romHash;
+    assets->cache = std::make_unique<BlitCache>(*assets);
+    return assets;
+}
+
+bool Assets::writePack(const std::string& path) const
+{
+    const DecodedAssets& data {*this};
+    PackHeader header {};
+    header.romHash = romHash;
+    header.hash = hash64(&data, sizeof(data));
+
+    std::ofstream file {path, std::ios::binary};
+    if (!file.is_open()) {
+        SDL_Log("error: can't open file '%s'.\n", path.c_str());
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&data), sizeof(data));
+    if (!file) {
+        SDL_Log("error [errno=%d]: failed when writing file '%s'.\n", errno, path.c_str());
+        return false;
+    }
+    return true;
+}
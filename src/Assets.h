@@ -0,0 +1,158 @@
+#ifndef PACMAN_ASSETS_H
+#define PACMAN_ASSETS_H
+
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <string>
+#include "Blit.h"
+
+/**
+ * Decodes a strip of pixels for a tile or sprite. The word 'image' here refers to either a tile or sprite.
+ * @param rom pointer to array of bytes
+ * @param array where to put the decoded pixels
+ * @param imageNum how many images have been decoded before this call (i.e. 0, 1, 2, ..., n)
+ * @param stripNum how many strips have been decoded before this call (i.e. 0, 1, 2, ..., n)
+ * @param pitch how many pixels per row in the image
+ * @param x the coordinate of the strip's top-left corner on the x-axis
+ * @param y the coordinate of the strip's top left corner on the y-axis
+ */
+constexpr void decodeStrip(const std::uint8_t* rom, std::uint8_t* array, const int imageNum, const int stripNum, const int pitch, const int x, const int y)
+{
+    for (int j {0}; j != 8; ++j) {
+        const std::uint8_t byte {rom[j + (stripNum * 8) + (imageNum * pitch * (pitch / 8 * 2))]};
+        const int xBase {(y * pitch * 4) + ((x + 1) * 8 - 1) - j};
+
+        array[xBase + pitch * 3] = ((byte & 0x10) >> 3U) | ((byte & 0x01U) >> 0U);
+        array[xBase + pitch * 2] = ((byte & 0x20) >> 4U) | ((byte & 0x02U) >> 1U);
+        array[xBase + pitch * 1] = ((byte & 0x40) >> 5U) | ((byte & 0x04U) >> 2U);
+        array[xBase + pitch * 0] = ((byte & 0x80) >> 6U) | ((byte & 0x08U) >> 3U);
+    }
+}
+
+// The rom images as dumped from the board (the sound prom is all zeros if missing).
+struct RomImages {
+    std::uint8_t program[0x4000]; // pacman.6e, pacman.6f, pacman.6h, pacman.6j
+    std::uint8_t color[0x20]; // 82s123.7f
+    std::uint8_t palette[0x100]; // 82s126.4a
+    std::uint8_t tile[0x1000]; // pacman.5e
+    std::uint8_t sprite[0x1000]; // pacman.5f
+    std::uint8_t sound[0x100]; // 82s126.1m
+};
+
+// Everything decoded from the roms. Plain data: it can be computed at compile time or copied out of an asset pack.
+struct DecodedAssets {
+    using Palette = std::uint32_t[4];
+    using PaletteColors = std::uint8_t[4];
+    using Tile = std::uint8_t[64];
+    using Sprite = std::uint8_t[256];
+    using Waveform = std::uint8_t[32];
+
+    std::uint8_t rom[0x4000] {};
+    std::array<Palette, 64> palettes {};
+    std::array<PaletteColors, 64> paletteColors {}; // color prom index [0,15] of each palette entry
+    std::array<Tile, 256> tiles {};
+    std::array<Sprite, 64> sprites {};
+    std::array<Waveform, 8> waveforms {}; // silent if the sound prom is missing
+};
+
+/**
+ * Decodes the palettes, tiles and sprites (usable at compile time).
+ * @param roms the rom images
+ * @param assets where to put the decoded data
+ */
+constexpr void decodeAssets(const RomImages& roms, DecodedAssets& assets)
+{
+    for (int i {0}; i != 0x4000; ++i)
+        assets.rom[i] = roms.program[i];
+
+    // decode palettes
+    for (int i {0}; i != 64; ++i) {
+        DecodedAssets::Palette& palette {assets.palettes[i]};
+        for (int j {0}; j != 4; ++j) {
+            assets.paletteColors[i][j] = roms.palette[j + (i * 4)] & 0x0F;
+            const std::uint8_t color {roms.color[assets.paletteColors[i][j]]};
+            std::uint8_t r {static_cast<uint8_t>(
+                                    (((color >> 0U) & 0b1) * 0x21)
+                                    + (((color >> 1U) & 0b1) * 0x47)
+                                    + (((color >> 2U) & 0b1) * 0x97))};
+            std::uint8_t g {static_cast<uint8_t>(
+                                    (((color >> 3U) & 0b1) * 0x21)
+                                    + (((color >> 4U) & 0b1) * 0x47)
+                                    + (((color >> 5U) & 0b1) * 0x97))};
+            std::uint8_t b {static_cast<uint8_t>(
+                                    (((color >> 6U) & 0b1) * 0x51)
+                                    + (((color >> 7U) & 0b1) * 0xAE))};
+            palette[j] = (0xFFU << 24U) | (b << 16U) | (g << 8U) | (r << 0U);
+        }
+    }
+
+    // decode tiles
+    for (int i {0}; i != 256; ++i) {
+        DecodedAssets::Tile& tile {assets.tiles[i]};
+
+        decodeStrip(roms.tile, tile, i, 0, 8, 0, 1);
+        decodeStrip(roms.tile, tile, i, 1, 8, 0, 0);
+    }
+
+    // decode sprites
+    for (int i {0}; i != 64; ++i) {
+        DecodedAssets::Sprite& sprite {assets.sprites[i]};
+
+        decodeStrip(roms.sprite, sprite, i, 0, 16, 1, 3);
+        decodeStrip(roms.sprite, sprite, i, 1, 16, 1, 0);
+        decodeStrip(roms.sprite, sprite, i, 2, 16, 1, 1);
+        decodeStrip(roms.sprite, sprite, i, 3, 16, 1, 2);
+        decodeStrip(roms.sprite, sprite, i, 4, 16, 0, 3);
+        decodeStrip(roms.sprite, sprite, i, 5, 16, 0, 0);
+        decodeStrip(roms.sprite, sprite, i, 6, 16, 0, 1);
+        decodeStrip(roms.sprite, sprite, i, 7, 16, 0, 2);
+    }
+
+    // the waveforms are used as is (4-bit samples)
+    for (int i {0}; i != 0x100; ++i)
+        assets.waveforms[i / 32][i % 32] = roms.sound[i];
+}
+
+/**
+ * The game's read-only data: program rom plus the tiles, sprites and palettes decoded from the graphics and color
+ * roms. Loaded once and shared by every Pacman instance; the blit cache is the only part that changes after loading.
+ */
+struct Assets : DecodedAssets {
+    /**
+     * Gets the assets from the fastest source available: roms embedded at build time (PACMAN_EMBED_ROMS, shared by
+     * every caller), else the rom files in dir, decoded by the asset pack dir/assets.pack if it was made from them.
+     * @param dir the rom file's parent directory
+     * @return the assets, or nullptr if any rom could not be loaded
+     */
+    static std::shared_ptr<const Assets> load(const std::string& dir);
+
+    /**
+     * Loads and decodes the individual rom files.
+     * @param dir the rom file's parent directory
+     * @return the assets, or nullptr if any rom could not be loaded
+     */
+    static std::shared_ptr<const Assets> loadRoms(const std::string& dir);
+
+    /**
+     * Reads an asset pack written by writePack.
+     * @param path the pack file
+     * @param romHash hash64 of the RomImages the pack must have been made from
+     * @return the assets, or nullptr if the pack is missing, corrupt, from another build or from other roms
+     */
+    static std::shared_ptr<const Assets> loadPack(const std::string& path, std::uint64_t romHash);
+
+    /**
+     * Writes the decoded data to an asset pack, a single file that loads without any decoding.
+     * @param path the pack file
+     * @return true if the pack was written; false otherwise
+     */
+    bool writePack(const std::string& path) const;
+
+    std::uint64_t romHash {}; // hash64 of the RomImages the data was decoded from
+    std::unique_ptr<BlitCache> cache;
+};
+
+
+#endif //PACMAN_ASSETS_H
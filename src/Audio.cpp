@@ -0,0 +1,62 @@
+#include "Audio.h"
+#include <algorithm>
+
+Audio::Audio()
+{
+    SDL_AudioSpec want {};
+    want.freq = sampleRate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = 512;
+    want.callback = callback;
+    want.userdata = this;
+
+    device = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
+    if (device == 0) {
+        SDL_Log("SDL_OpenAudioDevice() failed. SDL_Error: %s\n", SDL_GetError());
+        return;
+    }
+
+    // preallocate for the fastest ratio so push never allocates
+    resampled.resize(sampleRate / 50);
+    active = true;
+    SDL_PauseAudioDevice(device, 0);
+}
+
+Audio::~Audio()
+{
+    if (device != 0) SDL_CloseAudioDevice(device);
+}
+
+void Audio::push(const std::int16_t* samples, const int n, const int inputRate)
+{
+    if (!active) return;
+
+    // over target: consume input faster (fewer output samples), under target: slower
+    const double fill {(static_cast<double>(ring.size()) - targetFill) / targetFill};
+    const double step {static_cast<double>(inputRate) / sampleRate * (1.0 + std::clamp(fill, -1.0, 1.0) * maxRateDelta)};
+
+    // box filter over each output sample's span of input samples
+    std::size_t out {0};
+    for (; phase + step <= n and out != resampled.size(); phase += step) {
+        const int begin {static_cast<int>(phase)}, end {static_cast<int>(phase + step)};
+        int sum {0};
+        for (int i {begin}; i != end; ++i)
+            sum += samples[i];
+        resampled[out++] = static_cast<std::int16_t>(end > begin ? sum / (end - begin) : samples[begin]);
+    }
+    phase = std::max(0.0, phase - n);
+
+    ring.push(resampled.data(), out);
+}
+
+void Audio::callback(void* userdata, Uint8* stream, const int len)
+{
+    auto* audio {static_cast<Audio*>(userdata)};
+    auto* out {reinterpret_cast<std::int16_t*>(stream)};
+    const int n {len / static_cast<int>(sizeof(std::int16_t))};
+
+    const int got {static_cast<int>(audio->ring.pop(out, n))};
+    if (got != 0) audio->last = out[got - 1];
+    std::fill(out + got, out + n, audio->last);
+}
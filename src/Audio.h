@@ -0,0 +1,53 @@
+#ifndef PACMAN_AUDIO_H
+#define PACMAN_AUDIO_H
+
+
+#include <cstdint>
+#include <vector>
+#include "SDL.h"
+#include "SpscRing.h"
+
+/**
+ * SDL audio output. The emulator thread pushes each frame's WSG samples; they are resampled to the device rate and
+ * handed to the audio callback through a wait-free ring. The ring's fill level steers the resampling ratio (dynamic
+ * rate control) so jitter in frame pacing neither underruns nor overfills the device.
+ */
+class Audio {
+public:
+    static constexpr int sampleRate {48000};
+
+    // Opens the default output device (sets active).
+    Audio();
+
+    Audio(const Audio&) = delete;
+    Audio& operator=(const Audio&) = delete;
+
+    // Closes the device.
+    ~Audio();
+
+    /**
+     * Queues one frame of samples (emulator thread only).
+     * @param samples mono samples at inputRate
+     * @param n the number of samples
+     * @param inputRate the samples' rate
+     */
+    void push(const std::int16_t* samples, int n, int inputRate);
+
+    // True if the audio device was opened successfully; false otherwise.
+    bool active {false};
+private:
+    static constexpr int targetFill {2048}; // ~43 ms of queued audio
+    static constexpr double maxRateDelta {0.05}; // resampling ratio may drift by up to 5%
+
+    // SDL audio callback (audio thread): never locks or allocates.
+    static void callback(void* userdata, Uint8* stream, int len);
+
+    SpscRing<std::int16_t> ring {targetFill * 4};
+    SDL_AudioDeviceID device {0};
+    std::vector<std::int16_t> resampled;
+    double phase {0.0}; // position in the input between pushes
+    std::int16_t last {0}; // audio thread: repeated on underrun to avoid clicks
+};
+
+
+#endif //PACMAN_AUDIO_H
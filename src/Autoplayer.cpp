@@ -0,0 +1,81 @@
+#include "Autoplayer.h"
+#include <algorithm>
+#include <cstdlib>
+
+static constexpr std::uint8_t joystick[] {Pacman::up, Pacman::left, Pacman::right, Pacman::down};
+
+Autoplayer::Autoplayer(const std::shared_ptr<const Assets>& assets, const std::uint8_t ds, const int horizon,
+                       const int interval, const unsigned threads)
+    : horizon{std::max(horizon, 1)}, interval{std::max(interval, 1)},
+    pool{std::clamp(threads, 1U, static_cast<unsigned>(directions))}
+{
+    for (int i {0}; i != directions; ++i) {
+        workers.push_back(std::make_unique<Machine>(assets, ds, true));
+        workers.back()->render = false;
+        active &= workers.back()->pacman.active;
+    }
+    if (active) idle = workers[0]->pacman.keyInputs();
+}
+
+std::uint16_t Autoplayer::next(const Machine& machine)
+{
+    const GameState game {machine.pacman.state()};
+
+    if (game.phase() != GameState::playing) {
+        // insert a coin, then press start, as presses of 8 frames with 8 frame pauses
+        countdown = 0;
+        if ((machine.frameCount / 8) % 2 != 0) return idle;
+        return static_cast<std::uint16_t>(game.credits() == 0 ? idle & ~Pacman::coin1 : idle & ~(Pacman::onePlayer << 8));
+    }
+
+    if (countdown-- <= 0) {
+        countdown = interval - 1;
+        ++decisions;
+        machine.save(fork);
+        for (const auto& worker : workers)
+            worker->idleSkip = machine.idleSkip;
+
+        long long values[directions];
+        pool.parallelFor(directions, [this, &values](const int i) {
+            values[i] = rollout(*workers[i], joystick[i]);
+        });
+        rolloutFrames += static_cast<std::uint64_t>(horizon) * directions;
+
+        // keep the held direction on ties so Pac-Man doesn't dither
+        long long best {0};
+        for (int i {0}; i != directions; ++i) {
+            if (joystick[i] == held) best = values[i];
+        }
+        for (int i {0}; i != directions; ++i) {
+            if (values[i] > best) {
+                best = values[i];
+                held = joystick[i];
+            }
+        }
+    }
+
+    // the joystick bits are the same in both ports
+    return static_cast<std::uint16_t>(idle & ~(held | held << 8));
+}
+
+long long Autoplayer::rollout(Machine& worker, const std::uint8_t direction) const
+{
+    worker.restore(fork);
+    const GameState game {worker.pacman.state()};
+    const long long score {game.score()};
+    const int lives {game.lives()};
+    const GameState::Tile start {game.pacmanTile()};
+    const std::uint16_t inputs {static_cast<std::uint16_t>(idle & ~(direction | direction << 8))};
+
+    for (int frame {0}; frame != horizon; ++frame) {
+        worker.runFrame(inputs);
+        if (game.dying() or game.lives() < lives) {
+            // dying later is better than dying sooner, and any death is worse than surviving
+            return -1'000'000'000LL + frame;
+        }
+    }
+
+    const GameState::Tile end {game.pacmanTile()};
+    const int distance {std::abs(end.x - start.x) + std::abs(end.y - start.y)};
+    return (game.score() - score) * 16 + distance;
+}
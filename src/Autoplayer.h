@@ -0,0 +1,64 @@
+#ifndef PACMAN_AUTOPLAYER_H
+#define PACMAN_AUTOPLAYER_H
+
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Machine.h"
+#include "ThreadPool.h"
+
+/**
+ * Plays the game by lookahead. At every decision point the machine's state is forked into one worker per joystick
+ * direction; each worker holds its direction for a horizon of frames on a thread pool, and the direction with the best
+ * outcome (survival first, then score, then distance covered) is held until the next decision. Outside of a game it
+ * inserts a coin and presses start. Deterministic: the same machine state always gets the same inputs.
+ */
+class Autoplayer {
+public:
+    /**
+     * Constructor (also sets the active boolean).
+     * @param assets the shared roms and decoded graphics
+     * @param ds the dip switch settings of the machine being played
+     * @param horizon frames each direction is simulated for
+     * @param interval frames between decisions
+     * @param threads the total number of threads including the caller of next
+     */
+    Autoplayer(const std::shared_ptr<const Assets>& assets, std::uint8_t ds, int horizon, int interval = 8,
+               unsigned threads = std::thread::hardware_concurrency());
+
+    /**
+     * Chooses the inputs for the machine's next frame. Call once per frame, before running it.
+     * @param machine the machine being played
+     * @return IN1 << 8 | IN0 (active low)
+     */
+    std::uint16_t next(const Machine& machine);
+
+    // True if the workers were initialized successfully; false otherwise.
+    bool active {true};
+
+    // totals since construction
+    std::uint64_t decisions {0};
+    std::uint64_t rolloutFrames {0};
+private:
+    static constexpr int directions {4};
+
+    /**
+     * Simulates holding a direction from the forked state.
+     * @param worker the machine to simulate on
+     * @param direction the joystick bit to hold
+     * @return the outcome's value (higher is better)
+     */
+    long long rollout(Machine& worker, std::uint8_t direction) const;
+
+    const int horizon, interval;
+    std::vector<std::unique_ptr<Machine>> workers; // one per direction
+    ThreadPool pool;
+    Machine::State fork {};
+    std::uint16_t idle {}; // nothing pressed
+    std::uint8_t held {Pacman::left};
+    int countdown {0};
+};
+
+
+#endif //PACMAN_AUTOPLAYER_H
@@ -0,0 +1,50 @@
+#include "Batch.h"
+#include <cstring>
+
+Batch::Batch(const int n, const std::uint8_t ds, const unsigned threads, std::shared_ptr<const Assets> assets)
+    : frameBuffers(static_cast<std::size_t>(n) * frameSize), ramBuffers(static_cast<std::size_t>(n) * ramSize),
+    observationBuffers(n),
+    pool{threads}
+{
+    if (assets == nullptr)
+        assets = Assets::load("roms/");
+
+    machines.reserve(n);
+    for (int i {0}; i != n; ++i) {
+        machines.push_back(std::make_unique<Machine>(assets, ds, true));
+        machines.back()->pacman.setFrameBuffer(frameBuffers.data() + static_cast<std::size_t>(i) * frameSize);
+        active &= machines.back()->pacman.active;
+    }
+}
+
+void Batch::step()
+{
+    pool.parallelFor(size(), [this](const int i) {
+        Machine& machine {*machines[i]};
+        machine.runFrame();
+        std::memcpy(ramBuffers.data() + static_cast<std::size_t>(i) * ramSize, machine.pacman.memory(), ramSize);
+        machine.pacman.state().observe(observationBuffers[i]);
+    });
+}
+
+void Batch::renderIndexed(const IndexedRenderer& renderer, std::uint8_t* dst, const std::ptrdiff_t instanceStride,
+                          const std::ptrdiff_t rowStride)
+{
+    pool.parallelFor(size(), [&](const int i) {
+        Pacman::Video video;
+        machines[i]->pacman.capture(video);
+        renderer.render(video, dst + i * instanceStride, rowStride);
+    });
+}
+
+void Batch::setRender(const bool render)
+{
+    for (auto& machine : machines)
+        machine->render = render;
+}
+
+void Batch::setIdleSkip(const bool idleSkip)
+{
+    for (auto& machine : machines)
+        machine->idleSkip = idleSkip;
+}
@@ -0,0 +1,85 @@
+#ifndef PACMAN_BATCH_H
+#define PACMAN_BATCH_H
+
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "IndexedRenderer.h"
+#include "Machine.h"
+#include "ThreadPool.h"
+
+/**
+ * N independent headless machines stepped together, one frame per step, across a thread pool. The roms and decoded
+ * graphics are shared read-only; each machine only owns its ram and CPU state. Frames and ram are gathered into
+ * contiguous arrays (instance-major) so a whole batch can be handed off in one piece.
+ */
+class Batch {
+public:
+    static constexpr int frameSize {Pacman::screenWidth * Pacman::screenHeight};
+    static constexpr int ramSize {Pacman::ramSize};
+
+    /**
+     * Constructor (check active before stepping).
+     * @param n the number of machines
+     * @param ds the dip switch settings shared by every machine
+     * @param threads the number of threads to step with
+     * @param assets the shared roms and decoded graphics (loaded from roms/ if nullptr)
+     */
+    Batch(int n, std::uint8_t ds, unsigned threads = std::thread::hardware_concurrency(),
+          std::shared_ptr<const Assets> assets = nullptr);
+
+    /**
+     * Runs one frame on every machine, then copies each machine's ram into rams() and its decoded state into
+     * observations().
+     */
+    void step();
+
+    /**
+     * Turns rasterization on or off for every machine.
+     * @param render if false frames() is left untouched by step()
+     */
+    void setRender(bool render);
+
+    /**
+     * Turns idle loop skipping on or off for every machine.
+     * @param idleSkip see Machine::idleSkip
+     */
+    void setIdleSkip(bool idleSkip);
+
+    // The number of machines.
+    [[nodiscard]] int size() const { return static_cast<int>(machines.size()); }
+
+    // size() frames of frameSize ABGR8888 pixels each.
+    [[nodiscard]] const std::uint32_t* frames() const { return frameBuffers.data(); }
+
+    // size() copies of ramSize bytes each, as of the end of the last step.
+    [[nodiscard]] const std::uint8_t* rams() const { return ramBuffers.data(); }
+
+    // size() decoded game states, as of the end of the last step (what a bot needs, without the frames or ram).
+    [[nodiscard]] const GameState::Observation* observations() const { return observationBuffers.data(); }
+
+    /**
+     * Renders every machine's current frame with an indexed renderer, in parallel, without touching frames().
+     * @param renderer the format and size
+     * @param dst where machine 0's first row goes
+     * @param instanceStride bytes from one machine's first row to the next one's
+     * @param rowStride bytes from one row to the next
+     */
+    void renderIndexed(const IndexedRenderer& renderer, std::uint8_t* dst, std::ptrdiff_t instanceStride, std::ptrdiff_t rowStride);
+
+    // Direct access to one machine (e.g. to feed it input between steps).
+    Machine& operator[](const int i) { return *machines[i]; }
+
+    // True if every machine was initialized successfully; false otherwise.
+    bool active {true};
+private:
+    std::vector<std::unique_ptr<Machine>> machines;
+    std::vector<std::uint32_t> frameBuffers;
+    std::vector<std::uint8_t> ramBuffers;
+    std::vector<GameState::Observation> observationBuffers;
+    ThreadPool pool;
+};
+
+
+#endif //PACMAN_BATCH_H
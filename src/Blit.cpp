@@ -0,0 +1,163 @@
+#include "Blit.h"
+#include <bit>
+#include <cstring>
+#include "Assets.h"
+
+#if PACMAN_SIMD && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64))
+#include <immintrin.h>
+#endif
+
+static constexpr std::uint32_t black {0xFF000000};
+
+BlitCache::BlitCache(const Assets& assets) : assets{assets} {}
+
+BlitCache::~BlitCache()
+{
+    for (std::atomic<Block*>& block : blocks)
+        delete block.load(std::memory_order_relaxed);
+}
+
+BlitCache::Block::Block(const Assets& assets)
+    : tilePixels{new std::uint32_t[assets.tiles.size() * 64]},
+    tileState{new std::atomic<std::uint8_t>[assets.tiles.size()]()},
+    spritePixels{new std::uint32_t[assets.sprites.size() * 4 * 256]},
+    spriteMasks{new std::uint16_t[assets.sprites.size() * 4 * 16]},
+    spriteState{new std::atomic<std::uint8_t>[assets.sprites.size() * 4]()} {}
+
+BlitCache::Block& BlitCache::block(const int palette)
+{
+    std::atomic<Block*>& slot {blocks[palette]};
+    Block* block {slot.load(std::memory_order_acquire)};
+    if (block != nullptr) return *block;
+
+    // two threads may race to allocate it: the loser frees its copy
+    auto* fresh {new Block{assets}};
+    if (slot.compare_exchange_strong(block, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+        return *fresh;
+    delete fresh;
+    return *block;
+}
+
+bool BlitCache::claim(std::atomic<std::uint8_t>& state)
+{
+    std::uint8_t expected {empty};
+    return state.load(std::memory_order_acquire) == empty
+            and state.compare_exchange_strong(expected, filling, std::memory_order_acquire);
+}
+
+void expandTile(const Assets& assets, const int tile, const int palette, std::uint32_t* pixels)
+{
+    const Assets::Tile& src {assets.tiles[tile]};
+    const Assets::Palette& colors {assets.palettes[palette]};
+    for (int i {0}; i != 64; ++i)
+        pixels[i] = colors[src[i]];
+}
+
+void expandSprite(const Assets& assets, const int sprite, const int palette, const int flip, std::uint32_t* pixels,
+                  std::uint16_t* masks)
+{
+    const Assets::Sprite& src {assets.sprites[sprite]};
+    const Assets::Palette& colors {assets.palettes[palette]};
+    const bool flipX {static_cast<bool>(flip & 0b10)};
+    const bool flipY {static_cast<bool>(flip & 0b01)};
+    for (int i {0}; i != 16; ++i) {
+        std::uint16_t mask {0};
+        for (int j {0}; j != 16; ++j) {
+            const std::uint32_t color {colors[src[(flipX ? 15 - j : j) + ((flipY ? 15 - i : i) << 4)]]};
+            pixels[j + (i << 4)] = color;
+            if (color != black) mask |= 1U << j;
+        }
+        masks[i] = mask;
+    }
+}
+
+const std::uint32_t* BlitCache::tile(const int tile, const int palette)
+{
+    Block& entries {block(palette)};
+    std::uint32_t* pixels {entries.tilePixels.get() + tile * 64};
+    std::atomic<std::uint8_t>& state {entries.tileState[tile]};
+
+    if (state.load(std::memory_order_acquire) == ready) return pixels;
+    if (!claim(state)) return nullptr;
+
+    expandTile(assets, tile, palette, pixels);
+    state.store(ready, std::memory_order_release);
+    return pixels;
+}
+
+const std::uint32_t* BlitCache::sprite(const int sprite, const int palette, const int flip, const std::uint16_t*& masks)
+{
+    Block& entries {block(palette)};
+    const int entry {sprite * 4 + flip};
+    std::uint32_t* pixels {entries.spritePixels.get() + entry * 256};
+    std::uint16_t* rowMasks {entries.spriteMasks.get() + entry * 16};
+    std::atomic<std::uint8_t>& state {entries.spriteState[entry]};
+    masks = rowMasks;
+
+    if (state.load(std::memory_order_acquire) == ready) return pixels;
+    if (!claim(state)) return nullptr;
+
+    expandSprite(assets, sprite, palette, flip, pixels, rowMasks);
+    state.store(ready, std::memory_order_release);
+    return pixels;
+}
+
+void blitTileRow(std::uint32_t* dst, const std::uint32_t* src)
+{
+#if PACMAN_SIMD && defined(__AVX2__)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+#elif PACMAN_SIMD && (defined(__SSE2__) || defined(_M_X64))
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4)));
+#else
+    std::memcpy(dst, src, 8 * sizeof(std::uint32_t));
+#endif
+}
+
+/**
+ * Draws one unclipped sprite row: black source pixels leave the destination alone.
+ * @param dst the row's first pixel in the frame
+ * @param src 16 expanded pixels
+ */
+static void blendRow(std::uint32_t* dst, const std::uint32_t* src)
+{
+#if PACMAN_SIMD && defined(__AVX2__)
+    const __m256i transparent {_mm256_set1_epi32(static_cast<int>(black))};
+    for (int j {0}; j != 16; j += 8) {
+        const __m256i s {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + j))};
+        const __m256i d {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + j))};
+        const __m256i m {_mm256_cmpeq_epi32(s, transparent)};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + j), _mm256_blendv_epi8(s, d, m));
+    }
+#elif PACMAN_SIMD && (defined(__SSE2__) || defined(_M_X64))
+    const __m128i transparent {_mm_set1_epi32(static_cast<int>(black))};
+    for (int j {0}; j != 16; j += 4) {
+        const __m128i s {_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + j))};
+        const __m128i d {_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + j))};
+        const __m128i m {_mm_cmpeq_epi32(s, transparent)};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), _mm_or_si128(_mm_and_si128(m, d), _mm_andnot_si128(m, s)));
+    }
+#else
+    for (int j {0}; j != 16; ++j) {
+        if (src[j] != black)
+            dst[j] = src[j];
+    }
+#endif
+}
+
+void blitSpriteRow(std::uint32_t* line, const int x, const std::uint32_t* src, const std::uint16_t mask,
+                   const bool clipped)
+{
+    if (clipped) {
+        // cut by the screen edge: only touch visible opaque pixels, indexed from the line so no pointer is formed
+        // outside the frame
+        for (unsigned bits {mask}; bits != 0; bits &= bits - 1) {
+            const int j {std::countr_zero(bits)};
+            line[x + j] = src[j];
+        }
+    } else if (mask == 0xFFFF) {
+        std::memcpy(line + x, src, 16 * sizeof(std::uint32_t));
+    } else {
+        blendRow(line + x, src);
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef PACMAN_BLIT_H
+#define PACMAN_BLIT_H
+
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+struct Assets;
+
+/**
+ * Tiles and sprites expanded to 32-bit pixels, one entry per (tile, palette) and (sprite, palette, flip)
+ * combination, with a per-row opacity mask for sprites. Entries are filled on first use and may be shared by threads.
+ * Storage is allocated a palette at a time (about 330 KB: every tile and every sprite in every flip) when the palette
+ * is first drawn with, so only the palettes the game uses cost memory.
+ */
+class BlitCache {
+public:
+    static constexpr int palettes {64};
+
+    explicit BlitCache(const Assets& assets);
+
+    BlitCache(const BlitCache&) = delete;
+    BlitCache& operator=(const BlitCache&) = delete;
+
+    ~BlitCache();
+
+    /**
+     * Expanded tile pixels.
+     * @param tile the tile number [0,255]
+     * @param palette the palette number [0,63]
+     * @return 8 rows of 8 pixels, or nullptr if another thread is filling the entry right now
+     */
+    const std::uint32_t* tile(int tile, int palette);
+
+    /**
+     * Expanded sprite pixels with the flip already applied.
+     * @param sprite the sprite number [0,63]
+     * @param palette the palette number [0,63]
+     * @param flip bit 1 is flip-x, bit 0 is flip-y
+     * @param masks set to 16 row masks (bit j set if pixel j of the row is opaque)
+     * @return 16 rows of 16 pixels, or nullptr if another thread is filling the entry right now
+     */
+    const std::uint32_t* sprite(int sprite, int palette, int flip, const std::uint16_t*& masks);
+private:
+    enum : std::uint8_t { empty, filling, ready };
+
+    /**
+     * Claims an entry for filling if nobody has yet.
+     * @param state the entry's state
+     * @return true if the caller must fill the entry and then mark it ready; false otherwise
+     */
+    static bool claim(std::atomic<std::uint8_t>& state);
+
+    // One palette's entries (pixels are left uninitialized so the pages of unused entries are never touched).
+    struct Block {
+        explicit Block(const Assets& assets);
+
+        std::unique_ptr<std::uint32_t[]> tilePixels;
+        std::unique_ptr<std::atomic<std::uint8_t>[]> tileState;
+        std::unique_ptr<std::uint32_t[]> spritePixels;
+        std::unique_ptr<std::uint16_t[]> spriteMasks;
+        std::unique_ptr<std::atomic<std::uint8_t>[]> spriteState;
+    };
+
+    /**
+     * A palette's entries, allocated on first use.
+     * @param palette the palette number [0,63]
+     * @return the palette's block
+     */
+    Block& block(int palette);
+
+    const Assets& assets;
+    std::atomic<Block*> blocks[palettes] {};
+};
+
+/**
+ * Expands a tile to 32-bit pixels.
+ * @param assets the decoded graphics
+ * @param tile the tile number [0,255]
+ * @param palette the palette number [0,63]
+ * @param pixels where to write 8 rows of 8 pixels
+ */
+void expandTile(const Assets& assets, int tile, int palette, std::uint32_t* pixels);
+
+/**
+ * Expands a sprite to 32-bit pixels with the flip applied, and its row opacity masks.
+ * @param assets the decoded graphics
+ * @param sprite the sprite number [0,63]
+ * @param palette the palette number [0,63]
+ * @param flip bit 1 is flip-x, bit 0 is flip-y
+ * @param pixels where to write 16 rows of 16 pixels
+ * @param masks where to write 16 row masks (bit j set if pixel j of the row is opaque)
+ */
+void expandSprite(const Assets& assets, int sprite, int palette, int flip, std::uint32_t* pixels, std::uint16_t* masks);
+
+/**
+ * Copies one row of an expanded tile into the frame.
+ * @param dst the row's first pixel in the frame
+ * @param src 8 pixels
+ */
+void blitTileRow(std::uint32_t* dst, const std::uint32_t* src);
+
+/**
+ * Draws the opaque pixels of one row of an expanded sprite into a line of the frame.
+ * @param line the line's first pixel
+ * @param x the column of the row's first pixel (off screen to the left or right if the row is clipped)
+ * @param src 16 pixels
+ * @param mask the row's opacity mask, already clipped to the visible columns
+ * @param clipped true if the row is cut by the screen edge (then only the pixels in mask are touched)
+ */
+void blitSpriteRow(std::uint32_t* line, int x, const std::uint32_t* src, std::uint16_t mask, bool clipped);
+
+
+#endif //PACMAN_BLIT_H
@@ -0,0 +1,171 @@
+#include "Capture.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include "SDL.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+// _popen defaults to text mode, which would expand every 0x0A byte of the frames to 0x0D 0x0A
+static constexpr const char* pipeMode {"wb"};
+#else
+static constexpr const char* pipeMode {"w"}; // POSIX popen only accepts "r" or "w", and pipes are always binary
+#endif
+
+Capture::Capture(const std::string& path, const Format format, const Assets& assets, const int buffers)
+    : format{format}, pipe{!path.empty() and path.front() == '|'}, poolSize{static_cast<std::size_t>(std::max(buffers, 1))},
+    storage{std::make_unique<std::uint32_t[]>(poolSize * pixels)}, recycled{poolSize}, queued{poolSize}
+{
+    // every color the palettes can produce, in palette order (at most 256 since there are 64 palettes of 4)
+    if (format == indexed) {
+        for (const Assets::Palette& palette : assets.palettes) {
+            for (const std::uint32_t color : palette) {
+                if (std::find(colors.begin(), colors.end(), color) == colors.end())
+                    colors.push_back(color);
+            }
+        }
+    }
+
+    file = pipe ? popen(path.c_str() + 1, pipeMode) : std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        SDL_Log("error: can't open '%s' for capture.\n", path.c_str());
+        return;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    if (format == y4m) {
+        // the board's frame rate as a reduced fraction (2000:33, 60.606 Hz)
+        const int divisor {std::gcd(Pacman::pixelClock, Pacman::pixelsPerFrame)};
+        std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C444\n", Pacman::screenWidth, Pacman::screenHeight,
+                     Pacman::pixelClock / divisor, Pacman::pixelsPerFrame / divisor);
+    } else if (format == indexed) {
+        if (pipe) {
+            SDL_Log("warning: no palette file is written when capturing to a pipe.\n");
+        } else {
+            // the color table as R, G, B, A bytes per index
+            const std::string palettePath {path + ".pal"};
+            if (std::FILE* pal {std::fopen(palettePath.c_str(), "wb")}) {
+                for (const std::uint32_t color : colors) {
+                    const std::uint8_t bytes[4] {static_cast<std::uint8_t>(color), static_cast<std::uint8_t>(color >> 8),
+                                                 static_cast<std::uint8_t>(color >> 16), static_cast<std::uint8_t>(color >> 24)};
+                    std::fwrite(bytes, 1, sizeof(bytes), pal);
+                }
+                std::fclose(pal);
+            } else {
+                SDL_Log("error: can't open file '%s'.\n", palettePath.c_str());
+            }
+        }
+    }
+
+    for (std::size_t i {0}; i != poolSize; ++i) {
+        std::uint32_t* buffer {storage.get() + i * pixels};
+        recycled.push(&buffer, 1);
+    }
+
+    writer = std::thread {&Capture::write, this};
+    active = true;
+}
+
+Capture::~Capture()
+{
+    if (!active) return;
+
+    stopping.store(true, std::memory_order_release);
+    signal.fetch_add(1, std::memory_order_release);
+    signal.notify_one();
+    writer.join();
+
+    if (pipe) pclose(file); else std::fclose(file);
+    SDL_Log("captured %llu frames (%llu dropped because the writer fell behind).\n",
+            static_cast<unsigned long long>(frames), static_cast<unsigned long long>(dropped));
+}
+
+void Capture::frame(const std::uint32_t* frame, const bool wait)
+{
+    std::uint32_t* buffer {nullptr};
+    while (recycled.pop(&buffer, 1) == 0) {
+        if (!wait) {
+            ++dropped;
+            return;
+        }
+        const std::uint32_t seen {released.load(std::memory_order_acquire)};
+        if (recycled.size() == 0) released.wait(seen, std::memory_order_acquire);
+    }
+    std::memcpy(buffer, frame, pixels * sizeof(std::uint32_t));
+    queued.push(&buffer, 1);
+    ++frames;
+
+    signal.fetch_add(1, std::memory_order_release);
+    signal.notify_one();
+}
+
+void Capture::write()
+{
+    for (;;) {
+        std::uint32_t* buffer {nullptr};
+        if (queued.pop(&buffer, 1) == 0) {
+            const std::uint32_t seen {signal.load(std::memory_order_acquire)};
+            if (queued.size() != 0) continue;
+            if (stopping.load(std::memory_order_acquire)) break;
+            signal.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+
+        encode(buffer);
+        recycled.push(&buffer, 1);
+        released.fetch_add(1, std::memory_order_release);
+        released.notify_one();
+
+        if (!failed and std::fwrite(out.data(), 1, out.size(), file) != out.size()) {
+            SDL_Log("error: capture write failed, the rest of the frames are discarded.\n");
+            failed = true;
+        }
+    }
+    std::fflush(file);
+}
+
+void Capture::encode(const std::uint32_t* frame)
+{
+    if (format == rgba) {
+        // R, G, B, A bytes whatever the host's byte order
+        out.resize(pixels * sizeof(std::uint32_t));
+        for (int i {0}; i != pixels; ++i) {
+            const std::uint32_t color {frame[i]};
+            out[i * 4 + 0] = color & 0xFF;
+            out[i * 4 + 1] = color >> 8 & 0xFF;
+            out[i * 4 + 2] = color >> 16 & 0xFF;
+            out[i * 4 + 3] = color >> 24;
+        }
+    } else if (format == indexed) {
+        out.resize(pixels);
+        std::uint32_t last {colors.empty() ? 0 : colors[0]};
+        std::uint8_t index {0};
+        for (int i {0}; i != pixels; ++i) {
+            // runs of one color are the norm, so only search when the color changes
+            if (frame[i] != last) {
+                last = frame[i];
+                const auto it {std::find(colors.begin(), colors.end(), last)};
+                index = it != colors.end() ? static_cast<std::uint8_t>(it - colors.begin()) : 0;
+            }
+            out[i] = index;
+        }
+    } else {
+        // "FRAME\n" then full resolution Y, U and V planes (BT.601, limited range)
+        constexpr char header[] {"FRAME\n"};
+        constexpr std::size_t offset {sizeof(header) - 1};
+        out.resize(offset + pixels * 3);
+        std::memcpy(out.data(), header, offset);
+        std::uint8_t* y {out.data() + offset};
+        std::uint8_t* u {y + pixels};
+        std::uint8_t* v {u + pixels};
+        for (int i {0}; i != pixels; ++i) {
+            const int r {static_cast<int>(frame[i] & 0xFF)};
+            const int g {static_cast<int>(frame[i] >> 8 & 0xFF)};
+            const int b {static_cast<int>(frame[i] >> 16 & 0xFF)};
+            y[i] = static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            u[i] = static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[i] = static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
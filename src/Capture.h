@@ -0,0 +1,84 @@
+#ifndef PACMAN_CAPTURE_H
+#define PACMAN_CAPTURE_H
+
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Pacman.h"
+#include "SpscRing.h"
+
+/**
+ * Streams rendered frames to a file or a pipe without ever blocking the emulation on I/O. frame() copies the frame
+ * into a buffer from a fixed pool and queues it; a writer thread encodes and writes queued frames and recycles the
+ * buffers. If the writer falls behind so far that the pool runs dry, frames are dropped (and counted) rather than
+ * waited for.
+ */
+class Capture {
+public:
+    enum Format : std::uint8_t {
+        y4m, // YUV4MPEG2, 4:4:4 BT.601 (ffmpeg, mpv and most players read it)
+        rgba, // raw R, G, B, A bytes per pixel, frames back to back
+        indexed // raw 8-bit color indices, frames back to back; the colors are written to <path>.pal as RGBA
+    };
+
+    /**
+     * Constructor (also sets the active boolean).
+     * @param path the file to write, or a shell command to pipe into if it starts with '|'
+     * @param format the encoding
+     * @param assets the palettes, which give the color indices of the indexed format
+     * @param buffers how many frames can be queued before frames are dropped
+     */
+    Capture(const std::string& path, Format format, const Assets& assets, int buffers = 32);
+
+    // Writes every queued frame and closes the file.
+    ~Capture();
+
+    Capture(const Capture&) = delete;
+    Capture& operator=(const Capture&) = delete;
+
+    /**
+     * Queues a frame (emulation thread only).
+     * @param frame screenWidth * screenHeight ABGR8888 pixels, e.g. Pacman::frame()
+     * @param wait if true and the pool is empty, waits for the writer instead of dropping the frame (for runs that
+     *             are not paced in real time, like headless ones)
+     */
+    void frame(const std::uint32_t* frame, bool wait = false);
+
+    // True if the output was opened successfully; false otherwise.
+    bool active {false};
+private:
+    static constexpr int pixels {Pacman::screenWidth * Pacman::screenHeight};
+
+    // Writer thread: encodes and writes queued frames until stopping is set and the queue is empty.
+    void write();
+
+    /**
+     * Encodes a frame into out.
+     * @param frame the frame
+     */
+    void encode(const std::uint32_t* frame);
+
+    const Format format;
+    const bool pipe;
+    std::FILE* file {nullptr};
+    std::vector<std::uint32_t> colors; // color of each index (indexed format)
+    std::vector<std::uint8_t> out; // encoded frame (writer thread)
+
+    const std::size_t poolSize;
+    std::unique_ptr<std::uint32_t[]> storage; // the buffer pool
+    SpscRing<std::uint32_t*> recycled, queued; // buffers free to fill, buffers waiting for the writer
+    std::atomic<std::uint32_t> signal {0}; // bumped after every push to queued, and to stop
+    std::atomic<std::uint32_t> released {0}; // bumped after every push to recycled
+    std::atomic<bool> stopping {false};
+    std::uint64_t frames {0}, dropped {0};
+    bool failed {false};
+    std::thread writer;
+};
+
+
+#endif //PACMAN_CAPTURE_H
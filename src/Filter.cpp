@@ -0,0 +1,310 @@
+#include "Filter.h"
+#include <algorithm>
+#include <cstring>
+#include "SDL.h"
+
+#if PACMAN_SIMD && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64))
+#include <immintrin.h>
+#endif
+
+static constexpr std::uint32_t alpha {0xFF000000};
+
+// which channels each column of an aperture grille lets through at full strength (R, G, B in ABGR8888)
+static constexpr std::uint32_t grille[3] {0xFF0000FF, 0xFF00FF00, 0xFFFF0000};
+static constexpr std::uint32_t flat[3] {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
+
+/**
+ * Dims the channels of a pixel that aren't kept to 75%.
+ * @param p the pixel
+ * @param keep the channels to leave alone (alpha always is)
+ * @return the shaded pixel
+ */
+static std::uint32_t shade(const std::uint32_t p, const std::uint32_t keep)
+{
+    return (p & keep) | ((p - (p >> 2 & 0x3F3F3F3F)) & ~keep);
+}
+
+// Dims a pixel to 50%.
+static std::uint32_t half(const std::uint32_t p)
+{
+    return (p >> 1 & 0x7F7F7F7F) | alpha;
+}
+
+/**
+ * Scale2x of one pixel, with the neighbors clamped to the row.
+ * @param above the row above (the row itself on the first row)
+ * @param row the row
+ * @param below the row below (the row itself on the last row)
+ * @param out0 the upper output row
+ * @param out1 the lower output row
+ * @param x the pixel's column
+ * @param width the row's width
+ */
+static void scale2xPixel(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+                         std::uint32_t* out0, std::uint32_t* out1, const int x, const int width)
+{
+    const std::uint32_t a {above[x]}, b {row[x + 1 < width ? x + 1 : x]}, c {row[x > 0 ? x - 1 : 0]}, d {below[x]};
+    const std::uint32_t p {row[x]};
+    out0[x * 2 + 0] = c == a and c != d and a != b ? a : p;
+    out0[x * 2 + 1] = a == b and a != c and b != d ? b : p;
+    out1[x * 2 + 0] = d == c and d != b and c != a ? c : p;
+    out1[x * 2 + 1] = b == d and b != a and d != c ? d : p;
+}
+
+// Scale2x of a row (see scale2xPixel).
+static void scale2xRow(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+                       std::uint32_t* out0, std::uint32_t* out1, const int width)
+{
+    scale2xPixel(above, row, below, out0, out1, 0, width);
+    int x {1};
+#if PACMAN_SIMD && defined(__AVX2__)
+    for (; x + 9 <= width; x += 8) {
+        const __m256i a {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(above + x))};
+        const __m256i b {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x + 1))};
+        const __m256i c {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x - 1))};
+        const __m256i d {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(below + x))};
+        const __m256i p {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x))};
+        const __m256i ca {_mm256_cmpeq_epi32(c, a)}, ab {_mm256_cmpeq_epi32(a, b)};
+        const __m256i cd {_mm256_cmpeq_epi32(c, d)}, bd {_mm256_cmpeq_epi32(b, d)};
+
+        const __m256i e0 {_mm256_blendv_epi8(p, a, _mm256_andnot_si256(_mm256_or_si256(cd, ab), ca))};
+        const __m256i e1 {_mm256_blendv_epi8(p, b, _mm256_andnot_si256(_mm256_or_si256(ca, bd), ab))};
+        const __m256i e2 {_mm256_blendv_epi8(p, c, _mm256_andnot_si256(_mm256_or_si256(bd, ca), cd))};
+        const __m256i e3 {_mm256_blendv_epi8(p, d, _mm256_andnot_si256(_mm256_or_si256(ab, cd), bd))};
+
+        // interleave per 128-bit lane, then put the lanes back in order
+        const __m256i lo0 {_mm256_unpacklo_epi32(e0, e1)}, hi0 {_mm256_unpackhi_epi32(e0, e1)};
+        const __m256i lo1 {_mm256_unpacklo_epi32(e2, e3)}, hi1 {_mm256_unpackhi_epi32(e2, e3)};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out0 + x * 2), _mm256_permute2x128_si256(lo0, hi0, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out0 + x * 2 + 8), _mm256_permute2x128_si256(lo0, hi0, 0x31));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out1 + x * 2), _mm256_permute2x128_si256(lo1, hi1, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out1 + x * 2 + 8), _mm256_permute2x128_si256(lo1, hi1, 0x31));
+    }
+#elif PACMAN_SIMD && (defined(__SSE2__) || defined(_M_X64))
+    const auto select {[](const __m128i mask, const __m128i yes, const __m128i no) {
+        return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+    }};
+    for (; x + 5 <= width; x += 4) {
+        const __m128i a {_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x))};
+        const __m128i b {_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1))};
+        const __m128i c {_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1))};
+        const __m128i d {_mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x))};
+        const __m128i p {_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x))};
+        const __m128i ca {_mm_cmpeq_epi32(c, a)}, ab {_mm_cmpeq_epi32(a, b)};
+        const __m128i cd {_mm_cmpeq_epi32(c, d)}, bd {_mm_cmpeq_epi32(b, d)};
+
+        const __m128i e0 {select(_mm_andnot_si128(_mm_or_si128(cd, ab), ca), a, p)};
+        const __m128i e1 {select(_mm_andnot_si128(_mm_or_si128(ca, bd), ab), b, p)};
+        const __m128i e2 {select(_mm_andnot_si128(_mm_or_si128(bd, ca), cd), c, p)};
+        const __m128i e3 {select(_mm_andnot_si128(_mm_or_si128(ab, cd), bd), d, p)};
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out0 + x * 2), _mm_unpacklo_epi32(e0, e1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out0 + x * 2 + 4), _mm_unpackhi_epi32(e0, e1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out1 + x * 2), _mm_unpacklo_epi32(e2, e3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out1 + x * 2 + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+#endif
+    for (; x < width; ++x)
+        scale2xPixel(above, row, below, out0, out1, x, width);
+}
+
+/**
+ * Scale3x of one pixel, with the neighbors clamped to the row.
+ * @param above the row above (the row itself on the first row)
+ * @param row the row
+ * @param below the row below (the row itself on the last row)
+ * @param out the upper output row; the other two follow every outPitch pixels
+ * @param outPitch pixels per output row
+ * @param x the pixel's column
+ * @param width the row's width
+ */
+static void scale3xPixel(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+                         std::uint32_t* out, const int outPitch, const int x, const int width)
+{
+    const int l {x > 0 ? x - 1 : 0}, r {x + 1 < width ? x + 1 : x};
+    const std::uint32_t a {above[l]}, b {above[x]}, c {above[r]};
+    const std::uint32_t d {row[l]}, e {row[x]}, f {row[r]};
+    const std::uint32_t g {below[l]}, h {below[x]}, i {below[r]};
+    std::uint32_t* out0 {out + x * 3};
+    std::uint32_t* out1 {out0 + outPitch};
+    std::uint32_t* out2 {out1 + outPitch};
+
+    if (b == h or d == f) {
+        // no edge runs through this pixel
+        out0[0] = out0[1] = out0[2] = out1[0] = out1[1] = out1[2] = out2[0] = out2[1] = out2[2] = e;
+        return;
+    }
+    out0[0] = d == b ? d : e;
+    out0[1] = (d == b and e != c) or (b == f and e != a) ? b : e;
+    out0[2] = b == f ? f : e;
+    out1[0] = (d == b and e != g) or (d == h and e != a) ? d : e;
+    out1[1] = e;
+    out1[2] = (b == f and e != i) or (h == f and e != c) ? f : e;
+    out2[0] = d == h ? d : e;
+    out2[1] = (d == h and e != i) or (h == f and e != g) ? h : e;
+    out2[2] = h == f ? f : e;
+}
+
+// Scale3x of a row (see scale3xPixel).
+static void scale3xRow(const std::uint32_t* above, const std::uint32_t* row, const std::uint32_t* below,
+                       std::uint32_t* out, const int outPitch, const int width)
+{
+    scale3xPixel(above, row, below, out, outPitch, 0, width);
+    int x {1};
+#if PACMAN_SIMD && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64))
+    // most of the screen is flat color: four pixels with no edge through them are just tripled
+    for (; x + 5 <= width; x += 4) {
+        const __m128i b {_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x))};
+        const __m128i h {_mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x))};
+        const __m128i d {_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1))};
+        const __m128i f {_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1))};
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f))) != 0xFFFF) {
+            for (int i {0}; i != 4; ++i)
+                scale3xPixel(above, row, below, out, outPitch, x + i, width);
+            continue;
+        }
+
+        const __m128i e {_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x))};
+        const __m128i e0 {_mm_shuffle_epi32(e, _MM_SHUFFLE(1, 0, 0, 0))};
+        const __m128i e1 {_mm_shuffle_epi32(e, _MM_SHUFFLE(2, 2, 1, 1))};
+        const __m128i e2 {_mm_shuffle_epi32(e, _MM_SHUFFLE(3, 3, 3, 2))};
+        for (int i {0}; i != 3; ++i) {
+            std::uint32_t* dst {out + i * outPitch + x * 3};
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0), e0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), e1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), e2);
+        }
+    }
+#endif
+    for (; x < width; ++x)
+        scale3xPixel(above, row, below, out, outPitch, x, width);
+}
+
+/**
+ * Writes each pixel three times, shading every column with its part of a grille.
+ * @param src the source row
+ * @param out the output row (3 * width pixels)
+ * @param keep the channels each column phase keeps at full strength
+ * @param width the source width
+ */
+static void tripleRow(const std::uint32_t* src, std::uint32_t* out, const std::uint32_t (&keep)[3], const int width)
+{
+    int x {0};
+#if PACMAN_SIMD && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64))
+    // four source pixels become twelve, so the column phases repeat every three vectors
+    const __m128i keep0 {_mm_setr_epi32(static_cast<int>(keep[0]), static_cast<int>(keep[1]), static_cast<int>(keep[2]), static_cast<int>(keep[0]))};
+    const __m128i keep1 {_mm_setr_epi32(static_cast<int>(keep[1]), static_cast<int>(keep[2]), static_cast<int>(keep[0]), static_cast<int>(keep[1]))};
+    const __m128i keep2 {_mm_setr_epi32(static_cast<int>(keep[2]), static_cast<int>(keep[0]), static_cast<int>(keep[1]), static_cast<int>(keep[2]))};
+    const __m128i quarter {_mm_set1_epi32(0x3F3F3F3F)};
+    const auto shaded {[&quarter](const __m128i p, const __m128i k) {
+        const __m128i dimmed {_mm_sub_epi8(p, _mm_and_si128(_mm_srli_epi32(p, 2), quarter))};
+        return _mm_or_si128(_mm_and_si128(k, p), _mm_andnot_si128(k, dimmed));
+    }};
+    for (; x + 4 <= width; x += 4) {
+        const __m128i p {_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x))};
+        std::uint32_t* dst {out + x * 3};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0), shaded(_mm_shuffle_epi32(p, _MM_SHUFFLE(1, 0, 0, 0)), keep0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), shaded(_mm_shuffle_epi32(p, _MM_SHUFFLE(2, 2, 1, 1)), keep1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), shaded(_mm_shuffle_epi32(p, _MM_SHUFFLE(3, 3, 3, 2)), keep2));
+    }
+#endif
+    for (; x < width; ++x) {
+        out[x * 3 + 0] = shade(src[x], keep[0]);
+        out[x * 3 + 1] = shade(src[x], keep[1]);
+        out[x * 3 + 2] = shade(src[x], keep[2]);
+    }
+}
+
+/**
+ * Copies a row at half brightness.
+ * @param src the source row
+ * @param out the output row
+ * @param width the row's width
+ */
+static void halfRow(const std::uint32_t* src, std::uint32_t* out, const int width)
+{
+    int x {0};
+#if PACMAN_SIMD && defined(__AVX2__)
+    const __m256i mask {_mm256_set1_epi32(0x7F7F7F7F)}, opaque {_mm256_set1_epi32(static_cast<int>(alpha))};
+    for (; x + 8 <= width; x += 8) {
+        const __m256i p {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 1), mask), opaque));
+    }
+#elif PACMAN_SIMD && (defined(__SSE2__) || defined(_M_X64))
+    const __m128i mask {_mm_set1_epi32(0x7F7F7F7F)}, opaque {_mm_set1_epi32(static_cast<int>(alpha))};
+    for (; x + 4 <= width; x += 4) {
+        const __m128i p {_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 1), mask), opaque));
+    }
+#endif
+    for (; x < width; ++x)
+        out[x] = half(src[x]);
+}
+
+Filter::Filter(const Kind kind, const int width, const int height, const unsigned threads)
+    : type{kind}, width{width}, height{height}, factor{kind == none ? 1 : kind == scale2x ? 2 : 3},
+    output{kind == none ? nullptr : new std::uint32_t[static_cast<std::size_t>(width * factor) * height * factor]},
+    pool{kind == none ? 1 : std::max(threads, 1U)},
+    // a few bands per thread so one slow thread doesn't hold up the frame
+    bands{std::min(height, static_cast<int>(pool.size()) * 4)} {}
+
+Filter::~Filter()
+{
+    if (frames == 0 or type == none) return;
+
+    using Millis = std::chrono::duration<double, std::milli>;
+    SDL_Log("filter %s: %.3f ms/frame average, %.3f ms worst over %llu frames (%u threads, %d bands).\n", name(type),
+            Millis{total}.count() / static_cast<double>(frames), Millis{worst}.count(),
+            static_cast<unsigned long long>(frames), pool.size(), bands);
+}
+
+const char* Filter::name(const Kind kind)
+{
+    static constexpr const char* names[kinds] {"NONE", "SCALE2X", "SCALE3X", "SCANLINES", "CRT"};
+    return kind < kinds ? names[kind] : "?";
+}
+
+const std::uint32_t* Filter::apply(const std::uint32_t* frame)
+{
+    if (type == none) return frame;
+
+    const auto begin {std::chrono::steady_clock::now()};
+    pool.parallelFor(bands, [this, frame](const int i) {
+        band(frame, height * i / bands, height * (i + 1) / bands);
+    });
+    const std::chrono::steady_clock::duration elapsed {std::chrono::steady_clock::now() - begin};
+
+    ++frames;
+    total += elapsed;
+    worst = std::max(worst, elapsed);
+    return output.get();
+}
+
+void Filter::band(const std::uint32_t* frame, const int begin, const int end)
+{
+    const int pitch {outputWidth()};
+    for (int y {begin}; y != end; ++y) {
+        const std::uint32_t* row {frame + y * width};
+        const std::uint32_t* above {y > 0 ? row - width : row};
+        const std::uint32_t* below {y + 1 < height ? row + width : row};
+        std::uint32_t* out {output.get() + static_cast<std::size_t>(y) * factor * pitch};
+
+        switch (type) {
+            case scale2x:
+                scale2xRow(above, row, below, out, out + pitch, width);
+                break;
+            case scale3x:
+                scale3xRow(above, row, below, out, pitch, width);
+                break;
+            case scanlines:
+            case crt:
+                // two lit rows and a dark one between scanlines
+                tripleRow(row, out, type == crt ? grille : flat, width);
+                std::memcpy(out + pitch, out, pitch * sizeof(std::uint32_t));
+                halfRow(out, out + pitch * 2, pitch);
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef PACMAN_FILTER_H
+#define PACMAN_FILTER_H
+
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "ThreadPool.h"
+
+/**
+ * CPU post-processing of the raster buffer before it is uploaded: pixel-art upscalers and scanline/CRT looks, for
+ * machines where the renderer is a software one and the GPU can't be asked to do it. The output is split into
+ * horizontal bands that run in parallel on a thread pool, with SIMD inner loops. The cost of every frame is timed and
+ * reported when the filter is destroyed.
+ */
+class Filter {
+public:
+    enum Kind : std::uint8_t {
+        none, // the raster buffer as is
+        scale2x, // AdvMAME2x edge-directed 2x upscaling
+        scale3x, // AdvMAME3x edge-directed 3x upscaling
+        scanlines, // 3x with every third row darkened
+        crt, // 3x with an RGB aperture grille and darkened scanlines
+        kinds
+    };
+
+    /**
+     * Constructor.
+     * @param kind the filter
+     * @param width the source width in pixels
+     * @param height the source height in pixels
+     * @param threads the total number of threads including the caller of apply (at least 1)
+     */
+    Filter(Kind kind, int width, int height, unsigned threads);
+
+    // Logs the filter's average and worst cost per frame.
+    ~Filter();
+
+    Filter(const Filter&) = delete;
+    Filter& operator=(const Filter&) = delete;
+
+    /**
+     * Filters a frame. Must not be called concurrently.
+     * @param frame width * height ABGR8888 pixels
+     * @return outputWidth() * outputHeight() pixels, valid until the next call (frame itself for none)
+     */
+    const std::uint32_t* apply(const std::uint32_t* frame);
+
+    // The filter's name as given on the command line.
+    static const char* name(Kind kind);
+
+    [[nodiscard]] Kind kind() const { return type; }
+    [[nodiscard]] int scale() const { return factor; }
+    [[nodiscard]] int outputWidth() const { return width * factor; }
+    [[nodiscard]] int outputHeight() const { return height * factor; }
+private:
+    /**
+     * Filters the source rows [begin,end) into their output rows.
+     * @param frame the source frame
+     * @param begin the first source row
+     * @param end one past the last source row
+     */
+    void band(const std::uint32_t* frame, int begin, int end);
+
+    const Kind type;
+    const int width, height, factor;
+    std::unique_ptr<std::uint32_t[]> output;
+    ThreadPool pool;
+    const int bands;
+
+    // cost
+    std::uint64_t frames {0};
+    std::chrono::steady_clock::duration total {}, worst {};
+};
+
+
+#endif //PACMAN_FILTER_H
@@ -0,0 +1,186 @@
+#include "Frontend.h"
+#include <algorithm>
+#include <thread>
+#include "Pacer.h"
+#include "Rewind.h"
+
+Frontend::Frontend(const std::shared_ptr<const Assets>& assets, Options options)
+    : options{std::move(options)}, display{assets, this->options.dipswitch}, machine{assets, this->options.dipswitch},
+    keys{display.keyInputs()}
+{
+    active &= display.active and machine.pacman.active;
+    if (active and this->options.filter != nullptr) active &= display.setFilter(this->options.filter);
+    if (!active) {
+        display.off();
+        return;
+    }
+
+    // otherwise rendering is left to the display
+    machine.render = this->options.capture != nullptr or this->options.share != nullptr;
+    machine.idleSkip = this->options.idleSkip;
+    display.profiler = machine.pacman.profiler = this->options.profiler;
+
+    if (this->options.netplay != nullptr) {
+        // both peers must run one frame per tick, and only forward
+        if (!this->options.recordPath.empty()) SDL_Log("recording is disabled during netplay.\n");
+        if (this->options.rewindSeconds != 0) SDL_Log("rewind is disabled during netplay.\n");
+        this->options.recordPath.clear();
+        this->options.rewindSeconds = 0;
+        this->options.speed = this->options.turboSpeed = 1;
+        if (this->options.runAhead != 0) SDL_Log("run-ahead is disabled during netplay.\n");
+        this->options.runAhead = 0;
+    }
+    this->options.runAhead = std::clamp(this->options.runAhead, 0, maxRunAhead);
+
+    if (!this->options.recordPath.empty()) {
+        movie = std::make_unique<MovieWriter>(this->options.recordPath,
+                MovieHeader::make(*assets, this->options.dipswitch, this->options.checkpointInterval));
+        if (!movie->active) movie.reset();
+        if (this->options.rewindSeconds != 0) SDL_Log("rewind is disabled while recording.\n");
+        this->options.rewindSeconds = 0;
+    }
+
+    if (this->options.sound) audio = std::make_unique<Audio>();
+}
+
+void Frontend::run()
+{
+    std::thread emulator {&Frontend::emulate, this};
+
+    bool closed {!active};
+    while (!closed) {
+        // process SDL events, waking at least every millisecond to pick up new frames
+        SDL_Event e;
+        for (int pending {SDL_WaitEventTimeout(&e, 1)}; pending != 0; pending = SDL_PollEvent(&e)) {
+            if (e.type == SDL_QUIT) {
+                closed = true;
+            } else if (e.type == SDL_KEYDOWN) {
+                if (e.key.keysym.scancode == SDL_SCANCODE_BACKSPACE) rewinding.store(true, std::memory_order_relaxed);
+                if (e.key.keysym.scancode == SDL_SCANCODE_TAB) turbo.store(true, std::memory_order_relaxed);
+                display.onKeyDown(e.key.keysym.scancode);
+            } else if (e.type == SDL_KEYUP) {
+                if (e.key.keysym.scancode == SDL_SCANCODE_BACKSPACE) rewinding.store(false, std::memory_order_relaxed);
+                if (e.key.keysym.scancode == SDL_SCANCODE_TAB) turbo.store(false, std::memory_order_relaxed);
+                display.onKeyUp(e.key.keysym.scancode);
+            }
+        }
+        keys.store(display.keyInputs(), std::memory_order_relaxed);
+
+        // draw the newest finished frame (frames the display was too slow for are dropped)
+        if (frames.update()) {
+            display.show(frames.front());
+            display.draw();
+        }
+    }
+
+    quit.store(true, std::memory_order_relaxed);
+    emulator.join();
+    display.off();
+}
+
+void Frontend::emulate()
+{
+    Pacman& pacman {machine.pacman};
+
+    // ~512 bytes per frame of history is plenty for the few hundred ram bytes a frame usually touches
+    const int rewindFrames {static_cast<int>(std::chrono::seconds{options.rewindSeconds} / frameTime)};
+    Rewind rewind {static_cast<std::size_t>(rewindFrames) * 512, rewindFrames};
+    Machine::State state {}, ahead {};
+
+    // one frame of WSG output at a time
+    std::int16_t samples[samplesPerFrame];
+
+    // ticks that start after their deadline are run without being shown
+    Pacer pacer {frameTime};
+    int behind {0}; // ticks in a row that started late
+    std::uint64_t dropped {0};
+
+    while (!quit.load(std::memory_order_relaxed)) {
+        const Pacer::Clock::time_point begin {Pacer::Clock::now()};
+        const int speed {std::max(1, turbo.load(std::memory_order_relaxed) ? options.turboSpeed : options.speed)};
+
+        for (int i {0}; i != speed; ++i) {
+            const bool last {i + 1 == speed};
+            bool forward {true};
+
+            if (rewinding.load(std::memory_order_relaxed) and rewind.pop(state)) {
+                // step back a frame
+                machine.restore(state);
+                if (machine.render) pacman.render();
+                forward = false;
+            } else {
+                // run a frame with the keys held now, a reader's command, or the autoplayer's choice (also generates the
+                // interrupt if enabled)
+                std::uint16_t inputs {keys.load(std::memory_order_relaxed)};
+                if (options.share != nullptr) inputs = options.share->inputs(inputs);
+                if (options.autoplayer != nullptr) inputs = options.autoplayer->next(machine);
+                if (options.netplay == nullptr)
+                    machine.runFrame(inputs);
+                else if (!options.netplay->advance(machine, inputs))
+                    break; // waiting for the peer: show nothing new this tick
+                if (movie) movie->frame(pacman.inputs(), pacman.memory());
+                if (audio and last) {
+                    // one frame of sound per tick keeps the audio in real time while fast-forwarding
+                    pacman.synthesize(samples, std::size(samples));
+                    audio->push(samples, std::size(samples), Wsg::sampleRate);
+                }
+                if (rewindFrames != 0) {
+                    machine.save(state);
+                    rewind.push(state);
+                }
+            }
+
+            if (options.capture != nullptr) options.capture->frame(pacman.frame());
+            if (options.share != nullptr) options.share->publish(machine.frameCount, pacman.frame(), pacman.memory(), pacman.inputs());
+
+            if (last and behind == 0 and forward and options.runAhead != 0) {
+                // show where the keys held now lead a few frames on, then take those frames back, so a press shows
+                // up that much sooner
+                const Profiler::Scope scope {options.profiler, Profiler::runAhead};
+                machine.save(ahead);
+                const bool render {machine.render};
+                const Profiler::Accesses accesses {pacman.accesses};
+                machine.render = false;
+                pacman.profiler = nullptr; // the frames taken back are timed as a whole, not counted as frames
+                machine.runFrames(options.runAhead);
+                pacman.capture(frames.back());
+                frames.publish();
+                machine.restore(ahead, false); // nothing was rasterized ahead, the frame buffer is still this tick's
+                machine.render = render;
+                pacman.profiler = options.profiler;
+                pacman.accesses = accesses;
+            } else if (last and behind == 0) {
+                pacman.capture(frames.back());
+                frames.publish();
+            } else if (last) {
+                ++dropped;
+            }
+        }
+
+        if constexpr (Profiler::enabled) {
+            if (options.profiler != nullptr and Pacer::Clock::now() - begin > frameTime)
+                options.profiler->miss(machine.frameCount);
+        }
+
+        // wait until the next tick is due, or run it right away unshown if this one ended late
+        bool onTime;
+        {
+            const Profiler::Scope scope {options.profiler, Profiler::sleep};
+            onTime = pacer.wait();
+        }
+        if (onTime) {
+            behind = 0;
+        } else if (options.frameSkip and behind < maxFrameSkip) {
+            ++behind;
+        } else {
+            // too far behind to catch up: let the game slow down
+            behind = 0;
+            pacer.reset();
+        }
+    }
+
+    // leave the peer in the same state
+    if (options.netplay != nullptr) options.netplay->finish(machine, std::chrono::seconds{1});
+
+    if (dropped != 0) SDL_Log("%llu frames were dropped to keep up.\n", static_cast<unsigned long long>(dropped));
+}
@@ -0,0 +1,92 @@
+#ifndef PACMAN_FRONTEND_H
+#define PACMAN_FRONTEND_H
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Assets.h"
+#include "Audio.h"
+#include "Autoplayer.h"
+#include "Capture.h"
+#include "Machine.h"
+#include "Movie.h"
+#include "Netplay.h"
+#include "SharedFrames.h"
+#include "TripleBuffer.h"
+
+/**
+ * The windowed SDL frontend. Emulation runs on its own thread paced at the board's 60.606 frames/s and publishes each frame's video
+ * state into a triple buffer; the thread that calls run() owns the window, handles events, and rasterizes and
+ * presents the newest frame. A slow present (vsync, a compositor stall) never holds up emulation or sound, and the
+ * emulator never waits on the display.
+ *
+ * Frames are paced against a deadline. Fast-forward (holding tab, or a speed above 1) runs several frames per tick and
+ * only shows the last. When a tick overruns, the next ones run without publishing their frames until emulation is
+ * back on time, so a slow host drops frames instead of slowing the game down. With run-ahead, each shown frame is
+ * emulated a few frames past the real one with the keys held now, then the machine is restored: the game's own
+ * delay between reading a key and drawing its effect is hidden, at the cost of that many extra frames per tick.
+ */
+class Frontend {
+public:
+    struct Options {
+        std::uint8_t dipswitch {};
+        bool idleSkip {true}; // see Machine::idleSkip
+        bool sound {true};
+        int rewindSeconds {30}; // seconds of rewind history (hold backspace to rewind)
+        std::string recordPath; // record an input movie here if not empty (disables rewind)
+        int checkpointInterval {60}; // frames between movie ram checkpoints
+        Profiler* profiler {nullptr}; // where to record frame timings (none if nullptr)
+        Capture* capture {nullptr}; // where to stream every emulated frame (none if nullptr)
+        Filter* filter {nullptr}; // post-processes every presented frame (none if nullptr)
+        Autoplayer* autoplayer {nullptr}; // plays instead of the keyboard (none if nullptr)
+        SharedFrames* share {nullptr}; // where to publish every emulated frame, and take commanded inputs from
+        int speed {1}; // frames emulated per tick (only the last one is shown)
+        int turboSpeed {4}; // frames emulated per tick while tab is held
+        bool frameSkip {true}; // if emulation falls behind, catch up without showing frames instead of slowing down
+        int runAhead {0}; // frames emulated past the shown one and taken back [0,maxRunAhead]
+        Netplay* netplay {nullptr}; // a connected session the frames are run through (disables rewind and recording)
+    };
+
+    static constexpr int maxRunAhead {4};
+
+    /**
+     * Constructor (also sets the active boolean).
+     * @param assets the shared roms and decoded graphics
+     * @param options the frontend settings
+     */
+    Frontend(const std::shared_ptr<const Assets>& assets, Options options);
+
+    // Runs until the window is closed, then cleans up the window. Call from the thread that initialized SDL.
+    void run();
+
+    // True if the window and emulator were initialized successfully; false otherwise.
+    bool active {true};
+private:
+    // the board's refresh (16.5 ms, 60.606 Hz), the same frame the CPU runs cyclesPerFrame in
+    static constexpr std::chrono::nanoseconds frameTime {std::chrono::nanoseconds{std::chrono::seconds{1}}
+                                                         * Pacman::pixelsPerFrame / Pacman::pixelClock};
+    static constexpr int samplesPerFrame {static_cast<int>(Wsg::sampleRate * frameTime.count() / 1'000'000'000)};
+    static constexpr int maxFrameSkip {4}; // most ticks in a row run without being shown before the game slows down
+
+    // Emulator thread: runs, rewinds, records and plays sound one frame at a time until quit is set.
+    void emulate();
+
+    Options options;
+    Pacman display; // owns the window; only draws frames the machine ran
+    Machine machine; // headless, only renders while capturing or sharing (the display draws what is shown)
+    std::unique_ptr<MovieWriter> movie;
+    std::unique_ptr<Audio> audio;
+
+    // emulator thread -> display thread
+    TripleBuffer<Pacman::Video> frames;
+
+    // display thread -> emulator thread
+    std::atomic<std::uint16_t> keys;
+    std::atomic<bool> rewinding {false}, turbo {false}, quit {false};
+};
+
+
+#endif //PACMAN_FRONTEND_H
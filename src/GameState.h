@@ -0,0 +1,201 @@
+#ifndef PACMAN_GAMESTATE_H
+#define PACMAN_GAMESTATE_H
+
+
+#include <cstdint>
+
+/**
+ * A typed, read-only view of the game's variables decoded straight from the board's ram, so bots and batch runs can
+ * read the game state without rasterizing and parsing frames. Nothing is copied: every accessor reads the bytes it
+ * needs, and the view is valid as long as the ram it points into (Pacman::memory(), Batch::rams() or a snapshot).
+ *
+ * The addresses are the Midway Pac-Man rom's own variables (see the ram map below). Tile coordinates are the game's
+ * own, in which x runs from right to left.
+ */
+class GameState {
+public:
+    enum Direction : std::uint8_t { right, down, left, up };
+    enum Ghost : std::uint8_t { blinky, pinky, inky, clyde, ghosts };
+
+    enum GhostMode : std::uint8_t {
+        home, // in or leaving the ghost house
+        scatter, // heading for its corner
+        chase, // hunting Pac-Man
+        frightened, // blue after an energizer
+        eaten // eyes returning to the house
+    };
+
+    // The game's main state (the routine the rom's main loop dispatches to).
+    enum Phase : std::uint8_t { reset, attract, credited, playing };
+
+    struct Tile {
+        std::uint8_t x, y;
+    };
+
+    static constexpr int dotCount {240};
+    static constexpr int energizerCount {4};
+
+    /**
+     * Everything the accessors decode, packed for storage (about 60 bytes per step).
+     */
+    struct Observation {
+        Tile pacman;
+        Tile ghostTiles[ghosts];
+        Direction pacmanDirection;
+        Direction ghostDirections[ghosts];
+        GhostMode ghostModes[ghosts];
+        std::uint8_t dots[dotCount / 8]; // bit set: the dot is still there
+        std::uint8_t energizers; // bit i set: energizer i is still there
+        Phase phase;
+        std::uint8_t lives;
+        std::uint8_t level; // 0 for the first board
+        std::uint8_t dotsEaten;
+        std::uint8_t fruit; // 0 if no fruit is out, else the fruit's table entry
+        std::uint32_t score;
+    };
+
+    /**
+     * Constructor.
+     * @param ram the board's 4 KB of ram (0x4000-0x4FFF), e.g. Pacman::memory()
+     */
+    explicit GameState(const std::uint8_t* ram) : ram{ram} {}
+
+    [[nodiscard]] Phase phase() const { return static_cast<Phase>(at(mainState) & 3); }
+
+    [[nodiscard]] Tile pacmanTile() const { return tile(tiles + 2 * ghosts); }
+    [[nodiscard]] Direction pacmanDirection() const { return static_cast<Direction>(at(directions + ghosts) & 3); }
+
+    [[nodiscard]] Tile ghostTile(const Ghost ghost) const { return tile(tiles + 2 * ghost); }
+    [[nodiscard]] Direction ghostDirection(const Ghost ghost) const { return static_cast<Direction>(at(directions + ghost) & 3); }
+
+    // True from the moment Pac-Man is caught until the death animation ends.
+    [[nodiscard]] bool dying() const { return at(deathAnimation) != 0; }
+
+    // What a ghost is doing (scatter or chase only once it has left the house).
+    [[nodiscard]] GhostMode ghostMode(const Ghost ghost) const
+    {
+        if (at(ghostStates + ghost) != 0) return eaten;
+        if (at(ghostEdible + ghost) != 0) return frightened;
+        if (at(ghostSubstates + ghost) == 0) return home;
+        return (at(modePhase) & 1) == 0 ? scatter : chase;
+    }
+
+    /**
+     * Tells whether a dot is still on the board.
+     * @param index the dot's index in the rom's dot table [0,239]
+     * @return true if it hasn't been eaten
+     */
+    [[nodiscard]] bool dot(const int index) const { return (at(dotTable + index / 8) >> (index % 8) & 1) != 0; }
+
+    // The dot table itself, dotCount bits, one per dot (set: still there).
+    [[nodiscard]] const std::uint8_t* dots() const { return ram + dotTable - base; }
+
+    /**
+     * Tells whether an energizer is still on the board.
+     * @param index which one [0,3]
+     * @return true if it hasn't been eaten
+     */
+    [[nodiscard]] bool energizer(const int index) const { return at(energizerTable + index) == energizerTile; }
+
+    [[nodiscard]] int dotsEaten() const { return at(eatenCount); }
+    [[nodiscard]] int lives() const { return at(livesLeft); }
+    [[nodiscard]] int level() const { return at(board); }
+    // Credits inserted (kept as 2 BCD digits, the game stops counting at 99).
+    [[nodiscard]] int credits() const { return (at(creditCount) >> 4) * 10 + (at(creditCount) & 0x0F); }
+
+    // Whose turn it is in a two player game: 0 for player 1, 1 for player 2.
+    [[nodiscard]] int player() const { return at(currentPlayer) & 1; }
+
+    // 0 if no fruit is out, else the fruit's entry in the rom's fruit table.
+    [[nodiscard]] int fruit() const { return at(fruitEntry); }
+
+    // Player 1's score (kept as 6 BCD digits, least significant byte first).
+    [[nodiscard]] std::uint32_t score() const { return bcd(score1); }
+    [[nodiscard]] std::uint32_t highScore() const { return bcd(hiScore); }
+
+    /**
+     * Decodes everything into a compact copy.
+     * @param observation where to write the state
+     */
+    void observe(Observation& observation) const
+    {
+        observation.pacman = pacmanTile();
+        observation.pacmanDirection = pacmanDirection();
+        for (int i {0}; i != ghosts; ++i) {
+            const Ghost ghost {static_cast<Ghost>(i)};
+            observation.ghostTiles[i] = ghostTile(ghost);
+            observation.ghostDirections[i] = ghostDirection(ghost);
+            observation.ghostModes[i] = ghostMode(ghost);
+        }
+        for (int i {0}; i != dotCount / 8; ++i)
+            observation.dots[i] = at(dotTable + i);
+        observation.energizers = 0;
+        for (int i {0}; i != energizerCount; ++i)
+            observation.energizers |= energizer(i) << i;
+        observation.phase = phase();
+        observation.lives = at(livesLeft);
+        observation.level = at(board);
+        observation.dotsEaten = at(eatenCount);
+        observation.fruit = at(fruitEntry);
+        observation.score = score();
+    }
+private:
+    /**
+     * Ram map (absolute addresses; pairs are y then x):
+     * 0x4D0A-0x4D13: tile of blinky, pinky, inky, clyde and Pac-Man
+     * 0x4D2C-0x4D30: direction of blinky, pinky, inky, clyde and Pac-Man
+     * 0x4DA0-0x4DA3: ghost substate (0 while in the house)
+     * 0x4DA5: Pac-Man's death animation step (0 while alive)
+     * 0x4DA7-0x4DAA: ghost edible flag
+     * 0x4DAC-0x4DAF: ghost state (0 alive, else eyes on the way home or entering it)
+     * 0x4DC1: scatter/chase phase (even: scatter)
+     * 0x4DD4: fruit table entry (0 if no fruit is out)
+     * 0x4E00: main state
+     * 0x4E09: current player (0 or 1)
+     * 0x4E0E: dots eaten this board
+     * 0x4E13: board number (from 0)
+     * 0x4E14: lives left
+     * 0x4E16-0x4E33: dot table
+     * 0x4E34-0x4E37: energizer tiles (0x14 while uneaten)
+     * 0x4E6E: credits (BCD)
+     * 0x4E80-0x4E82: player 1 score, 0x4E88-0x4E8A: high score
+     */
+    static constexpr std::uint16_t base {0x4000};
+    static constexpr std::uint16_t tiles {0x4D0A};
+    static constexpr std::uint16_t directions {0x4D2C};
+    static constexpr std::uint16_t ghostSubstates {0x4DA0};
+    static constexpr std::uint16_t deathAnimation {0x4DA5};
+    static constexpr std::uint16_t ghostEdible {0x4DA7};
+    static constexpr std::uint16_t ghostStates {0x4DAC};
+    static constexpr std::uint16_t modePhase {0x4DC1};
+    static constexpr std::uint16_t fruitEntry {0x4DD4};
+    static constexpr std::uint16_t mainState {0x4E00};
+    static constexpr std::uint16_t currentPlayer {0x4E09};
+    static constexpr std::uint16_t eatenCount {0x4E0E};
+    static constexpr std::uint16_t board {0x4E13};
+    static constexpr std::uint16_t livesLeft {0x4E14};
+    static constexpr std::uint16_t dotTable {0x4E16};
+    static constexpr std::uint16_t energizerTable {0x4E34};
+    static constexpr std::uint16_t creditCount {0x4E6E};
+    static constexpr std::uint16_t score1 {0x4E80};
+    static constexpr std::uint16_t hiScore {0x4E88};
+    static constexpr std::uint8_t energizerTile {0x14};
+
+    [[nodiscard]] std::uint8_t at(const std::uint16_t addr) const { return ram[addr - base]; }
+    [[nodiscard]] Tile tile(const std::uint16_t addr) const { return {at(addr + 1), at(addr)}; }
+
+    [[nodiscard]] std::uint32_t bcd(const std::uint16_t addr) const
+    {
+        std::uint32_t value {0};
+        for (int i {2}; i >= 0; --i) {
+            const std::uint8_t byte {at(addr + i)};
+            value = value * 100 + (byte >> 4) * 10 + (byte & 0x0F);
+        }
+        return value;
+    }
+
+    const std::uint8_t* ram;
+};
+
+
+#endif //PACMAN_GAMESTATE_H
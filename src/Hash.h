@@ -0,0 +1,26 @@
+#ifndef PACMAN_HASH_H
+#define PACMAN_HASH_H
+
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 64-bit FNV-1a hash.
+ * @param data the bytes to hash
+ * @param sz the number of bytes
+ * @param hash the hash to continue from
+ * @return the hash
+ */
+inline std::uint64_t hash64(const void* data, const std::size_t sz, std::uint64_t hash = 0xCBF29CE484222325ULL)
+{
+    const auto* bytes {static_cast<const std::uint8_t*>(data)};
+    for (std::size_t i {0}; i != sz; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+
+#endif //PACMAN_HASH_H
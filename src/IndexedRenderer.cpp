@@ -0,0 +1,96 @@
+#include "IndexedRenderer.h"
+#include <algorithm>
+#include <cstring>
+#include "TileMap.h"
+
+IndexedRenderer::IndexedRenderer(const Assets& assets, const Format format, const int downsample)
+    : assets{assets}, format{format}, factor{downsample >= 4 ? 4 : downsample >= 2 ? 2 : 1}
+{
+    for (int i {0}; i != 256; ++i) {
+        const std::uint32_t color {assets.palettes[i / 4][i % 4]};
+        opaque[i] = color != 0xFF000000;
+
+        if (format == paletteIndex) {
+            values[i] = static_cast<std::uint8_t>(i);
+        } else if (format == colorIndex) {
+            values[i] = assets.paletteColors[i / 4][i % 4];
+        } else {
+            const std::uint32_t r {color & 0xFF}, g {color >> 8 & 0xFF}, b {color >> 16 & 0xFF};
+            values[i] = static_cast<std::uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+}
+
+void IndexedRenderer::render(const Pacman::Video& video, std::uint8_t* dst, const std::ptrdiff_t stride) const
+{
+    constexpr int width {Pacman::screenWidth};
+    std::uint8_t band[8][width];
+
+    // a tile row at a time: the band stays in cache while it is drawn and reduced
+    for (int ty {0}; ty != Pacman::screenHeight / 8; ++ty) {
+        drawBand(video, ty, band);
+
+        for (int i {0}; i < 8; i += factor) {
+            std::uint8_t* out {dst + (ty * 8 + i) / factor * stride};
+            if (factor == 1) {
+                std::memcpy(out, band[i], width);
+            } else if (format != grayscale) {
+                for (int x {0}; x != width / factor; ++x)
+                    out[x] = band[i][x * factor];
+            } else {
+                for (int x {0}; x != width / factor; ++x) {
+                    int sum {0};
+                    for (int dy {0}; dy != factor; ++dy) {
+                        for (int dx {0}; dx != factor; ++dx)
+                            sum += band[i + dy][x * factor + dx];
+                    }
+                    out[x] = static_cast<std::uint8_t>((sum + factor * factor / 2) / (factor * factor));
+                }
+            }
+        }
+    }
+}
+
+void IndexedRenderer::drawBand(const Pacman::Video& video, const int ty, std::uint8_t (*band)[Pacman::screenWidth]) const
+{
+    constexpr int width {Pacman::screenWidth};
+    const bool flip {video.flipScreen}; // the whole screen turned 180 degrees
+
+    for (int tx {0}; tx != width / 8; ++tx) {
+        const int loc {flip ? tileMap.loc[Pacman::screenHeight / 8 - 1 - ty][width / 8 - 1 - tx] : tileMap.loc[ty][tx]};
+        const Assets::Tile& tile {assets.tiles[video.tiles[loc]]};
+        const std::uint8_t* lut {values + (video.tiles[loc + 0x400] & 0x3F) * 4};
+        for (int i {0}; i != 8; ++i) {
+            for (int j {0}; j != 8; ++j)
+                band[i][tx * 8 + j] = lut[tile[flip ? (7 - j) + ((7 - i) << 3) : j + (i << 3)]];
+        }
+    }
+
+    // sprites in reverse order so the first one ends up on top, clipped to the band
+    const int top {ty * 8};
+    for (int n {14}; n >= 0; n -= 2) {
+        int x {width - video.spritePos[n] + 15};
+        int y {Pacman::screenHeight - video.spritePos[n + 1] - 16};
+        if (flip) {
+            x = width - 16 - x;
+            y = Pacman::screenHeight - 16 - y;
+        }
+        if (x >= width or x + 16 <= 0 or y >= top + 8 or y + 16 <= top) continue;
+
+        const std::uint8_t byte0 {video.sprites[n]}; // upper 6 bits are the sprite #, bit 1 is flip-x, bit 0 is flip-y
+        const Assets::Sprite& sprite {assets.sprites[byte0 >> 2]};
+        const int palette {(video.sprites[n + 1] & 0x3F) * 4};
+        const bool flipX {static_cast<bool>(byte0 & 0b10) != flip};
+        const bool flipY {static_cast<bool>(byte0 & 0b01) != flip};
+
+        const int i0 {std::max(0, top - y)}, i1 {std::min(16, top + 8 - y)};
+        const int j0 {std::max(0, -x)}, j1 {std::min(16, width - x)};
+        for (int i {i0}; i != i1; ++i) {
+            const int row {flipY ? 15 - i : i};
+            for (int j {j0}; j != j1; ++j) {
+                const int entry {palette + sprite[(flipX ? 15 - j : j) + (row << 4)]};
+                if (opaque[entry]) band[y + i - top][x + j] = values[entry];
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PACMAN_INDEXEDRENDERER_H
+#define PACMAN_INDEXEDRENDERER_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include "Pacman.h"
+
+/**
+ * Renders frames as one byte per pixel straight from the video state, into caller-owned memory with any row stride
+ * (e.g. one instance's slice of a batch tensor). An alternative to the 32-bit frame buffer for consumers that don't
+ * need true color: 4 times smaller at full size, and down to 64 times smaller when downsampled.
+ */
+class IndexedRenderer {
+public:
+    enum Format : std::uint8_t {
+        paletteIndex, // palette * 4 + pixel value [0,255]: the most information a pixel carries
+        colorIndex, // the color prom index [0,15]: the 16 colors on screen
+        grayscale // luma [0,255]
+    };
+
+    /**
+     * Constructor.
+     * @param assets the decoded graphics (must outlive this object)
+     * @param format what each byte holds
+     * @param downsample 1, 2 or 4: each output pixel covers a downsample x downsample block (grayscale averages the
+     *                   block, the index formats take its upper left pixel)
+     */
+    IndexedRenderer(const Assets& assets, Format format, int downsample = 1);
+
+    [[nodiscard]] int width() const { return Pacman::screenWidth / factor; }
+    [[nodiscard]] int height() const { return Pacman::screenHeight / factor; }
+
+    /**
+     * Renders a frame. Thread-safe: nothing but the output is written.
+     * @param video the video state, e.g. from Pacman::capture
+     * @param dst the first byte of the first output row
+     * @param stride bytes from one output row to the next (at least width())
+     */
+    void render(const Pacman::Video& video, std::uint8_t* dst, std::ptrdiff_t stride) const;
+private:
+    /**
+     * Draws one row of tiles with the sprites over it.
+     * @param video the video state
+     * @param ty the tile row [0,35]
+     * @param band where to draw, 8 rows of screenWidth pixels
+     */
+    void drawBand(const Pacman::Video& video, int ty, std::uint8_t (*band)[Pacman::screenWidth]) const;
+
+    const Assets& assets;
+    const Format format;
+    const int factor;
+    std::uint8_t values[256] {}; // output value of each palette * 4 + pixel
+    bool opaque[256] {}; // if false, sprites don't draw that palette entry
+};
+
+
+#endif //PACMAN_INDEXEDRENDERER_H
@@ -0,0 +1,173 @@
+#include "Machine.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+template<class Trace>
+BasicMachine<Trace>::BasicMachine(const std::uint8_t ds, const bool headless) : pacman{ds, headless}, cpu{pacman} {}
+
+template<class Trace>
+BasicMachine<Trace>::BasicMachine(std::shared_ptr<const Assets> assets, const std::uint8_t ds, const bool headless)
+    : pacman{std::move(assets), ds, headless}, cpu{pacman} {}
+
+template<class Trace>
+void BasicMachine<Trace>::runFrame()
+{
+    [[maybe_unused]] const int budget {cycles};
+    pacman.trace.frame(frameCount);
+    if (interruptPending) {
+        cpu.reqInt(pacman.interruptVector);
+        interruptPending = false;
+    }
+    {
+        const Profiler::Scope scope {pacman.profiler, Profiler::cpu};
+        // a traced machine must make every bus access the game makes, so it never skips
+        if (idleSkip and std::is_same_v<Trace, NullTrace>)
+            runSkippingIdle();
+        else
+            cycles = cyclesPerFrame + cpu.run(cycles); // cpu.run -> a negative value representing the number of exceeded cycles
+    }
+
+    if (render)
+        pacman.render();
+
+    // generate interrupt if enabled (taken by the CPU at the start of the next frame, so save states never hold a
+    // request inside the CPU)
+    interruptPending = pacman.interruptEnabled;
+
+    ++frameCount;
+
+    if constexpr (Profiler::enabled) {
+        if (pacman.profiler != nullptr) {
+            const int overshoot {cyclesPerFrame - cycles};
+            pacman.profiler->frame(frameCount, budget + overshoot, overshoot, pacman.accesses);
+        }
+    }
+}
+
+/**
+ * Compares two register sets apart from R, which the CPU advances on every opcode fetch: an n-instruction loop only
+ * brings R back after lcm(n, 128) instructions.
+ * @param a the first set
+ * @param b the second set
+ * @return true if every other register is the same
+ */
+static bool sameButRefresh(CpuRegisters a, const CpuRegisters& b)
+{
+    a.r = b.r;
+    return a == b;
+}
+
+template<class Trace>
+void BasicMachine<Trace>::runSkippingIdle()
+{
+    const int budget {cycles};
+    int consumed {0};
+    bool compare {false};
+    Snapshot* last {&idleBoards[0]};
+    Snapshot* now {&idleBoards[1]};
+    Snapshot& probe {idleBoards[2]};
+
+    // slicing stops at the same instruction boundary as one cpu.run(budget) would: the first at or past the budget
+    while (consumed < budget) {
+        const int slice {std::min(idleSlice, budget - consumed)};
+        consumed += slice - cpu.run(slice);
+        if (consumed >= budget) break;
+
+        pacman.save(*now);
+        if (compare and *now == *last) {
+            // only the CPU changed for a whole slice: step until its registers repeat (cpu.run(1) is one instruction)
+            const CpuRegisters start {registers()};
+            const int from {consumed};
+            for (int n {0}; n != idleProbe and consumed < budget; ++n) {
+                consumed += 1 - cpu.run(1);
+                if (!sameButRefresh(registers(), start)) continue;
+
+                pacman.save(probe);
+                if (probe == *now and consumed < budget) {
+                    // the whole machine repeats every period cycles until the interrupt: jump to the last
+                    // repetition before the frame boundary and run the rest normally
+                    const int period {consumed - from};
+                    const int periods {(budget - 1 - consumed) / period};
+                    consumed += periods * period;
+                    skippedCycles += static_cast<std::uint64_t>(periods) * period;
+
+                    // R's low 7 bits count opcode fetches: advance them by the fetches of the skipped periods
+                    CpuRegisters skipped {registers()};
+                    const int fetches {(skipped.r - start.r) & 0x7F};
+                    skipped.r = static_cast<std::uint8_t>((skipped.r & 0x80) | ((skipped.r + periods * fetches) & 0x7F));
+                    setRegisters(skipped);
+                }
+                break;
+            }
+            compare = false;
+            continue;
+        }
+
+        std::swap(last, now);
+        compare = true;
+    }
+
+    cycles = cyclesPerFrame + budget - consumed;
+}
+
+template<class Trace>
+void BasicMachine<Trace>::runFrames(const int n)
+{
+    for (int i {0}; i != n; ++i)
+        runFrame();
+}
+
+template<class Trace>
+void BasicMachine<Trace>::save(State& state) const
+{
+    state.cpu = registers();
+    state.interruptPending = interruptPending;
+    state.cycles = cycles;
+    state.frameCount = frameCount;
+    pacman.save(state.hardware);
+}
+
+template<class Trace>
+void BasicMachine<Trace>::restore(const State& state, const bool redraw)
+{
+    setRegisters(state.cpu);
+    interruptPending = state.interruptPending;
+    cycles = state.cycles;
+    frameCount = state.frameCount;
+    pacman.restore(state.hardware, redraw);
+}
+
+template<class Trace>
+CpuRegisters BasicMachine<Trace>::registers() const
+{
+    return {cpu.pc, cpu.sp, cpu.ix, cpu.iy, cpu.af, cpu.bc, cpu.de, cpu.hl, cpu.af_, cpu.bc_, cpu.de_, cpu.hl_,
+            cpu.i, cpu.r, cpu.im, cpu.iff1, cpu.iff2, cpu.halt};
+}
+
+template<class Trace>
+void BasicMachine<Trace>::setRegisters(const CpuRegisters& registers)
+{
+    cpu.pc = registers.pc;
+    cpu.sp = registers.sp;
+    cpu.ix = registers.ix;
+    cpu.iy = registers.iy;
+    cpu.af = registers.af;
+    cpu.bc = registers.bc;
+    cpu.de = registers.de;
+    cpu.hl = registers.hl;
+    cpu.af_ = registers.af2;
+    cpu.bc_ = registers.bc2;
+    cpu.de_ = registers.de2;
+    cpu.hl_ = registers.hl2;
+    cpu.i = registers.i;
+    cpu.r = registers.r;
+    cpu.im = registers.im;
+    cpu.iff1 = registers.iff1;
+    cpu.iff2 = registers.iff2;
+    cpu.halt = registers.halted;
+}
+
+template class BasicMachine<NullTrace>;
+template class BasicMachine<AccessTrace>;
+template class BasicMachine<Watchpoints>;
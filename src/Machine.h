@@ -0,0 +1,156 @@
+#ifndef PACMAN_MACHINE_H
+#define PACMAN_MACHINE_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include "Pacman.h"
+
+/**
+ * The Z80's programmer-visible state. Save states hold these values rather than the CPU object, so they never carry
+ * the CPU's binding to its board and can be restored into any machine.
+ */
+struct CpuRegisters {
+    std::uint16_t pc, sp, ix, iy;
+    std::uint16_t af, bc, de, hl; // main set
+    std::uint16_t af2, bc2, de2, hl2; // shadow set (AF', BC', DE', HL')
+    std::uint8_t i, r, im;
+    bool iff1, iff2, halted;
+
+    bool operator==(const CpuRegisters&) const = default;
+};
+
+/**
+ * A Pac-Man board wired to its Z80. Steps the emulation one video frame at a time with no pacing, so it can be
+ * driven as fast as the host allows (headless soak tests, bots) or paced by the caller (the SDL frontend).
+ * @tparam Trace the board's memory tracing policy (see Trace.h)
+ */
+template<class Trace>
+class BasicMachine {
+public:
+    using Board = BasicPacman<Trace>;
+    using Z80 = typename Board::Z80;
+    using Snapshot = typename Board::Snapshot;
+
+    static constexpr int clockSpeed {Board::pixelClock / 2}; // 3.072 MHz
+    static constexpr int cyclesPerFrame {Board::pixelsPerFrame / 2}; // 50688: a frame is 16.5 ms, not 1/60 s
+
+    /**
+     * A whole-machine save state. Plain data: copy it with memcpy or assignment to clone a machine for lookahead.
+     * The board's ram is the last member so Rewind can store everything before it verbatim and only delta-encode ram.
+     */
+    struct State {
+        CpuRegisters cpu;
+        bool interruptPending;
+        int cycles;
+        std::uint64_t frameCount;
+        Snapshot hardware;
+    };
+
+    // Bytes of State before the board's ram.
+    static constexpr std::size_t stateHeaderSize {offsetof(State, hardware) + offsetof(Snapshot, ram)};
+
+    /**
+     * Constructor (check pacman.active before running).
+     * @param ds the dip switch settings
+     * @param headless if true no window is created
+     */
+    explicit BasicMachine(std::uint8_t ds, bool headless = true);
+
+    /**
+     * Constructor (check pacman.active before running).
+     * @param assets the shared roms and decoded graphics
+     * @param ds the dip switch settings
+     * @param headless if true no window is created
+     */
+    BasicMachine(std::shared_ptr<const Assets> assets, std::uint8_t ds, bool headless = true);
+
+    BasicMachine(const BasicMachine&) = delete;
+    BasicMachine& operator=(const BasicMachine&) = delete;
+
+    /**
+     * Runs one frame: a frame's worth of cycles, rasterization (if enabled) and the vblank interrupt.
+     */
+    void runFrame();
+
+    /**
+     * Sets the inputs, then runs one frame.
+     * @param inputs IN1 << 8 | IN0 (active low)
+     */
+    void runFrame(const std::uint16_t inputs) { pacman.setInputs(inputs); runFrame(); }
+
+    /**
+     * Runs frames back to back.
+     * @param n the number of frames to run
+     */
+    void runFrames(int n);
+
+    /**
+     * Saves the whole machine (CPU, board and cycle debt). Cheap enough to call every frame.
+     * @param state where to write the state
+     */
+    void save(State& state) const;
+
+    /**
+     * Restores a state saved from this or any other machine.
+     * @param state the state to restore
+     * @param redraw see Pacman::restore
+     */
+    void restore(const State& state, bool redraw = true);
+
+    // Reads the CPU's registers.
+    [[nodiscard]] CpuRegisters registers() const;
+
+    /**
+     * Writes the CPU's registers.
+     * @param registers the values to load
+     */
+    void setRegisters(const CpuRegisters& registers);
+
+    // If false frames are emulated but never rasterized.
+    bool render {true};
+
+    /**
+     * If true the CPU runs in slices of idleSlice cycles. After a slice in which nothing but the CPU's registers
+     * changed, it steps single instructions until every register but R is back to its value at the start; if the
+     * board is also unchanged the machine is spinning (waiting for vblank), so the cycle counter jumps forward by
+     * whole loop periods to just before the frame boundary, and R by the opcode fetches of those periods. Frames, ram
+     * and registers are the same either way (tests/idle_skip). The skipped bus accesses are never made, so machines
+     * with a Trace ignore it.
+     */
+    bool idleSkip {true};
+
+    // Cycles fast-forwarded by idleSkip since construction.
+    std::uint64_t skippedCycles {0};
+
+    Board pacman;
+    Z80 cpu;
+
+    // Cycle budget for the next frame (carries the previous frame's overshoot).
+    int cycles {cyclesPerFrame};
+
+    // The vblank interrupt raised at the end of the last frame, requested from the CPU when the next one starts.
+    bool interruptPending {false};
+
+    // Number of frames run since construction.
+    std::uint64_t frameCount {0};
+private:
+    static constexpr int idleSlice {512};
+    static constexpr int idleProbe {256}; // most instructions to step looking for a loop (longer loops aren't skipped)
+
+    // Runs this frame's cycles in slices, skipping idle loops.
+    void runSkippingIdle();
+
+    Snapshot idleBoards[3] {}; // last slice, this slice, probe
+};
+
+
+// The production machine: no tracing.
+using Machine = BasicMachine<NullTrace>;
+
+extern template class BasicMachine<NullTrace>;
+extern template class BasicMachine<AccessTrace>;
+extern template class BasicMachine<Watchpoints>;
+
+
+#endif //PACMAN_MACHINE_H
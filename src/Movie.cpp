@@ -0,0 +1,196 @@
+#include "Movie.h"
+#include <string_view>
+#include "SDL.h"
+
+// record tags
+static constexpr std::uint8_t endTag {0};
+static constexpr std::uint8_t inputsTag {1};
+static constexpr std::uint8_t checkpointTag {2};
+
+/**
+ * Writes an unsigned integer in little endian.
+ * @param file the stream to write to
+ * @param val the value
+ * @param sz the number of bytes to write
+ */
+static void writeInt(std::ostream& file, const std::uint64_t val, const int sz)
+{
+    for (int i {0}; i != sz; ++i)
+        file.put(static_cast<char>(val >> (i * 8)));
+}
+
+/**
+ * Reads an unsigned integer in little endian.
+ * @param file the stream to read from
+ * @param sz the number of bytes to read
+ * @return the value (garbage if the stream failed)
+ */
+static std::uint64_t readInt(std::istream& file, const int sz)
+{
+    std::uint64_t val {0};
+    for (int i {0}; i != sz; ++i)
+        val |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(file.get())) << (i * 8);
+    return val;
+}
+
+// Writes an unsigned LEB128 varint.
+static void writeVarint(std::ostream& file, std::uint64_t val)
+{
+    do {
+        const auto byte {static_cast<std::uint8_t>(val & 0x7F)};
+        val >>= 7;
+        file.put(static_cast<char>(val != 0 ? byte | 0x80 : byte));
+    } while (val != 0);
+}
+
+// Reads an unsigned LEB128 varint.
+static std::uint64_t readVarint(std::istream& file)
+{
+    std::uint64_t val {0};
+    for (int shift {0}; shift < 64; shift += 7) {
+        const int byte {file.get()};
+        if (byte == std::char_traits<char>::eof()) break;
+        val |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) break;
+    }
+    return val;
+}
+
+MovieHeader MovieHeader::make(const Assets& assets, const std::uint8_t dipswitch, const std::uint32_t checkpointInterval)
+{
+    MovieHeader header {};
+    header.dipswitch = dipswitch;
+    header.checkpointInterval = checkpointInterval;
+    header.romHash = hash64(assets.rom, sizeof(assets.rom));
+    header.graphicsHash = hash64(assets.palettes.data(), sizeof(assets.palettes));
+    header.graphicsHash = hash64(assets.tiles.data(), sizeof(assets.tiles), header.graphicsHash);
+    header.graphicsHash = hash64(assets.sprites.data(), sizeof(assets.sprites), header.graphicsHash);
+    return header;
+}
+
+MovieWriter::MovieWriter(const std::string& path, const MovieHeader& header)
+    : file{path, std::ios::binary}, checkpointInterval{header.checkpointInterval}
+{
+    if (!file.is_open()) {
+        SDL_Log("error: can't create movie '%s'.\n", path.c_str());
+        return;
+    }
+
+    file.write("PMOV", 4);
+    file.put(static_cast<char>(MovieHeader::version));
+    file.put(static_cast<char>(header.dipswitch));
+    writeInt(file, header.checkpointInterval, 4);
+    writeInt(file, header.romHash, 8);
+    writeInt(file, header.graphicsHash, 8);
+    active = file.good();
+}
+
+MovieWriter::~MovieWriter()
+{
+    close();
+}
+
+void MovieWriter::frame(const std::uint16_t inputs, const std::uint8_t* ram)
+{
+    if (!active) return;
+
+    if (runLength != 0 and inputs != runInputs)
+        flush();
+    runInputs = inputs;
+    ++runLength;
+    ++frames;
+
+    if (checkpointInterval != 0 and frames % checkpointInterval == 0) {
+        flush();
+        file.put(static_cast<char>(checkpointTag));
+        writeVarint(file, frames);
+        writeInt(file, hash64(ram, 0x1000), 8);
+    }
+}
+
+void MovieWriter::close()
+{
+    if (!active) return;
+
+    flush();
+    file.put(static_cast<char>(endTag));
+    writeVarint(file, frames);
+    file.close();
+    active = false;
+}
+
+void MovieWriter::flush()
+{
+    if (runLength == 0) return;
+
+    file.put(static_cast<char>(inputsTag));
+    writeInt(file, runInputs, 2);
+    writeVarint(file, runLength);
+    runLength = 0;
+}
+
+MovieReader::MovieReader(const std::string& path) : file{path, std::ios::binary}
+{
+    if (!file.is_open()) {
+        SDL_Log("error: can't open movie '%s'.\n", path.c_str());
+        return;
+    }
+
+    char magic[4] {};
+    file.read(magic, 4);
+    const int version {file.get()};
+    header.dipswitch = static_cast<std::uint8_t>(file.get());
+    header.checkpointInterval = static_cast<std::uint32_t>(readInt(file, 4));
+    header.romHash = readInt(file, 8);
+    header.graphicsHash = readInt(file, 8);
+
+    if (!file.good() or std::string_view{magic, 4} != "PMOV" or version != MovieHeader::version) {
+        SDL_Log("error: '%s' is not a version %d movie.\n", path.c_str(), MovieHeader::version);
+        return;
+    }
+
+    active = true;
+    read();
+}
+
+bool MovieReader::next(std::uint16_t& inputs)
+{
+    // skip checkpoints nobody asked about
+    while (tag == checkpointTag or (tag == inputsTag and runLeft == 0))
+        read();
+
+    if (tag != inputsTag) return false;
+
+    inputs = runInputs;
+    if (--runLeft == 0)
+        read();
+    return true;
+}
+
+bool MovieReader::checkpoint(const std::uint64_t frame, std::uint64_t& hash)
+{
+    if (tag != checkpointTag or checkpointFrame != frame) return false;
+
+    hash = checkpointHash;
+    read();
+    return true;
+}
+
+void MovieReader::read()
+{
+    const int next {file.get()};
+    tag = next == std::char_traits<char>::eof() ? endTag : static_cast<std::uint8_t>(next);
+
+    if (tag == inputsTag) {
+        runInputs = static_cast<std::uint16_t>(readInt(file, 2));
+        runLeft = readVarint(file);
+    } else if (tag == checkpointTag) {
+        checkpointFrame = readVarint(file);
+        checkpointHash = readInt(file, 8);
+    } else {
+        tag = endTag;
+    }
+
+    if (!file.good())
+        tag = endTag;
+}
@@ -0,0 +1,120 @@
+#ifndef PACMAN_MOVIE_H
+#define PACMAN_MOVIE_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "Assets.h"
+#include "Hash.h"
+
+/**
+ * Input movie file format (little endian, streamed front to back):
+ *   header: "PMOV", version, dip switch, checkpoint interval (u32), program rom hash (u64), graphics hash (u64)
+ *   records, each starting with a tag byte:
+ *     1 inputs: IN1 << 8 | IN0 (u16), frame count (varint) -- the inputs held for that many frames
+ *     2 checkpoint: frame number (varint), hash64 of ram after that frame (u64)
+ *     0 end: total frames (varint)
+ * A movie starts from a freshly constructed machine.
+ */
+struct MovieHeader {
+    static constexpr std::uint8_t version {2}; // 2: frames of 50688 cycles (60.606 Hz) instead of 51200
+
+    std::uint8_t dipswitch {};
+    std::uint32_t checkpointInterval {};
+    std::uint64_t romHash {};
+    std::uint64_t graphicsHash {};
+
+    /**
+     * Hashes the assets a movie was recorded with.
+     * @param assets the roms and decoded graphics
+     * @param dipswitch the dip switch settings
+     * @param checkpointInterval frames between ram checkpoints (0 for none)
+     * @return the header
+     */
+    static MovieHeader make(const Assets& assets, std::uint8_t dipswitch, std::uint32_t checkpointInterval);
+};
+
+/**
+ * Writes a movie one frame at a time.
+ */
+class MovieWriter {
+public:
+    /**
+     * Constructor (check active before use).
+     * @param path the file to create
+     * @param header the movie's header
+     */
+    MovieWriter(const std::string& path, const MovieHeader& header);
+
+    // Finishes the file (same as close).
+    ~MovieWriter();
+
+    /**
+     * Appends a frame. Call after the frame has run.
+     * @param inputs the inputs the frame ran with
+     * @param ram the board's ram after the frame (hashed at checkpoints)
+     */
+    void frame(std::uint16_t inputs, const std::uint8_t* ram);
+
+    // Writes the end record and closes the file.
+    void close();
+
+    // True if the file was opened successfully; false otherwise.
+    bool active {false};
+private:
+    // Writes the pending inputs run.
+    void flush();
+
+    std::ofstream file;
+    std::uint32_t checkpointInterval;
+    std::uint64_t frames {0};
+    std::uint16_t runInputs {};
+    std::uint64_t runLength {0};
+};
+
+/**
+ * Reads a movie back one frame at a time.
+ */
+class MovieReader {
+public:
+    /**
+     * Constructor (check active before use).
+     * @param path the file to open
+     */
+    explicit MovieReader(const std::string& path);
+
+    /**
+     * Gets the next frame's inputs.
+     * @param inputs where to write IN1 << 8 | IN0
+     * @return false at the end of the movie; true otherwise
+     */
+    bool next(std::uint16_t& inputs);
+
+    /**
+     * Looks for a checkpoint after the given frame.
+     * @param frame the number of frames run so far
+     * @param hash where to write the recorded ram hash
+     * @return true if the movie has a checkpoint for this frame; false otherwise
+     */
+    bool checkpoint(std::uint64_t frame, std::uint64_t& hash);
+
+    MovieHeader header {};
+
+    // True if the file was opened and its header is valid; false otherwise.
+    bool active {false};
+private:
+    // Reads the next record into the lookahead (end on error or end of file).
+    void read();
+
+    std::ifstream file;
+    std::uint8_t tag {0};
+    std::uint16_t runInputs {};
+    std::uint64_t runLeft {0};
+    std::uint64_t checkpointFrame {0};
+    std::uint64_t checkpointHash {0};
+};
+
+
+#endif //PACMAN_MOVIE_H
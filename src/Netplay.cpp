@@ -0,0 +1,392 @@
+#include "Netplay.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "Hash.h"
+#include "Movie.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(sockaddr_in) <= 16, "the peer's address is kept in 16 bytes");
+
+static void closeSocket(const std::intptr_t sock)
+{
+#if defined(_WIN32)
+    closesocket(static_cast<SOCKET>(sock));
+#else
+    close(static_cast<int>(sock));
+#endif
+}
+
+/**
+ * Opens a non-blocking IPv4 UDP socket.
+ * @param port the local port to bind (0 for any)
+ * @return the socket, or -1 on failure
+ */
+static std::intptr_t openSocket(const int port)
+{
+#if defined(_WIN32)
+    static const bool started {[] { WSADATA data; return WSAStartup(MAKEWORD(2, 2), &data) == 0; }()};
+    if (!started) return -1;
+    const SOCKET s {::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)};
+    if (s == INVALID_SOCKET) return -1;
+    u_long nonBlocking {1};
+    const bool configured {ioctlsocket(s, FIONBIO, &nonBlocking) == 0};
+    const auto sock {static_cast<std::intptr_t>(s)};
+#else
+    const int s {::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)};
+    if (s == -1) return -1;
+    const bool configured {fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0};
+    const auto sock {static_cast<std::intptr_t>(s)};
+#endif
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (!configured or bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        closeSocket(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// little endian packet fields
+static void put(std::vector<std::uint8_t>& out, const std::uint64_t value, const int bytes)
+{
+    for (int i {0}; i != bytes; ++i)
+        out.push_back(static_cast<std::uint8_t>(value >> i * 8));
+}
+
+static std::uint64_t get(const std::uint8_t*& in, const int bytes)
+{
+    std::uint64_t value {0};
+    for (int i {0}; i != bytes; ++i)
+        value |= static_cast<std::uint64_t>(*in++) << i * 8;
+    return value;
+}
+
+Netplay::Netplay(const Assets& assets, const std::uint8_t ds, Options options)
+    : options{std::move(options)}, player{this->options.peer.empty() ? 1 : 2}, dipswitch{ds}
+{
+    const MovieHeader header {MovieHeader::make(assets, ds, 0)};
+    romHash = header.romHash;
+    graphicsHash = header.graphicsHash;
+
+    // this peer's first inputDelay frames have no keys behind them
+    localFrames = static_cast<std::uint32_t>(std::clamp(this->options.inputDelay, 0, maxInputDelay));
+    std::fill(std::begin(local), std::end(local), Pacman::idleInputs);
+
+    sock = openSocket(this->options.port);
+    if (sock == -1) {
+        SDL_Log("error: can't open a UDP socket on port %d.\n", this->options.port);
+        return;
+    }
+
+    if (player == 2) {
+        const std::size_t colon {this->options.peer.rfind(':')};
+        const std::string host {this->options.peer.substr(0, colon)};
+        const std::string port {colon == std::string::npos ? "7000" : this->options.peer.substr(colon + 1)};
+        addrinfo hints {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* found {nullptr};
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 or found == nullptr) {
+            SDL_Log("error: can't resolve '%s'.\n", this->options.peer.c_str());
+            return;
+        }
+        std::memcpy(peerAddress, found->ai_addr, sizeof(sockaddr_in));
+        freeaddrinfo(found);
+        peerKnown = true;
+    }
+    active = true;
+}
+
+Netplay::~Netplay()
+{
+    if (sock != -1) closeSocket(sock);
+}
+
+bool Netplay::connect(const std::chrono::milliseconds timeout)
+{
+    if (!active) return false;
+    if (player == 1)
+        SDL_Log("netplay: waiting for player 2 on port %d.\n", options.port);
+
+    const auto deadline {std::chrono::steady_clock::now() + timeout};
+    while (std::chrono::steady_clock::now() < deadline and !rejected) {
+        receive();
+        flush();
+        if (connected) {
+            SDL_Log("netplay: connected as player %d.\n", player);
+            return true;
+        }
+        if (peerKnown and std::chrono::steady_clock::now() - lastHello >= helloInterval) sendHello();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    if (!rejected) SDL_Log("error: no answer from the other player.\n");
+    return false;
+}
+
+bool Netplay::advance(Machine& machine, const std::uint16_t keys)
+{
+    receive();
+    flush();
+    const auto now {std::chrono::steady_clock::now()};
+    if (connected and now - lastReceived > disconnectTimeout) {
+        // the inputs missed meanwhile are beyond the history and the snapshots, so the sessions can't be joined again
+        SDL_Log("netplay: the other player stopped answering, the session is over and their inputs are idle from now on.\n");
+        connected = false;
+        ended = true;
+    }
+
+    // wait if rolling back would reach past the snapshots kept, or (now and then) if this peer runs further ahead of
+    // the other than the other runs ahead of it
+    const int advantage {static_cast<int>(current) - static_cast<int>(remoteFrames)};
+    if (connected and (advantage >= maxRollback or (advantage - remoteAdvantage >= 2 and sinceStall >= stallSpacing))) {
+        if (sinceStall != 0) ++stalls; // count waits, not retries
+        sinceStall = 0;
+        if (now - lastSent >= resendInterval) sendInputs();
+        return false;
+    }
+    ++sinceStall;
+
+    local[localFrames % history] = keys;
+    ++localFrames;
+    sendInputs();
+
+    if (mispredicted < current) rollback(machine);
+    checkpoint(machine);
+    step(machine, current++);
+    return true;
+}
+
+bool Netplay::finish(Machine& machine, const std::chrono::milliseconds timeout)
+{
+    const auto deadline {std::chrono::steady_clock::now() + timeout};
+    while (connected and std::chrono::steady_clock::now() < deadline) {
+        receive();
+        flush();
+        if (mispredicted < current) rollback(machine);
+        checkpoint(machine);
+        if (remoteFrames >= current and remoteAck >= current and outgoing.empty()) break;
+        if (std::chrono::steady_clock::now() - lastSent >= resendInterval) sendInputs();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    // the peer may still be waiting for the acknowledgement of its last inputs
+    sendInputs();
+    while (!outgoing.empty() and std::chrono::steady_clock::now() < deadline) {
+        flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    return remoteFrames >= current;
+}
+
+void Netplay::step(Machine& machine, const std::uint32_t frame)
+{
+    constexpr std::uint16_t stick {(Pacman::up | Pacman::left | Pacman::right | Pacman::down) * 0x101};
+
+    machine.save(states[frame % (maxRollback + 1)]);
+    const std::uint16_t theirs {remoteInput(frame)};
+    simulated[frame % history] = theirs;
+
+    // the joystick belongs to whoever's turn it is, the buttons and switches to both players
+    const std::uint16_t player1 {player == 1 ? local[frame % history] : theirs};
+    const std::uint16_t player2 {player == 1 ? theirs : local[frame % history]};
+    const std::uint16_t turn {machine.pacman.state().player() == 0 ? player1 : player2};
+    machine.runFrame(static_cast<std::uint16_t>((player1 & player2 & ~stick) | (turn & stick)));
+}
+
+std::uint16_t Netplay::remoteInput(const std::uint32_t frame) const
+{
+    if (frame < remoteFrames) return remote[frame % history];
+    return connected and remoteFrames != 0 ? remote[(remoteFrames - 1) % history] : Pacman::idleInputs;
+}
+
+void Netplay::rollback(Machine& machine)
+{
+    const std::uint32_t from {mispredicted};
+    mispredicted = UINT32_MAX;
+
+    // replay without rasterizing: only the frame advance() runs next is shown
+    const bool render {machine.render};
+    machine.render = false;
+    machine.restore(states[from % (maxRollback + 1)]);
+    for (std::uint32_t frame {from}; frame != current; ++frame)
+        step(machine, frame);
+    machine.render = render;
+
+    ++rollbacks;
+    resimulatedFrames += current - from;
+}
+
+void Netplay::checkpoint(const Machine& machine)
+{
+    // ram at the start of a frame is final once every input before it is confirmed
+    while (nextCheckpoint <= std::min(remoteFrames, current)) {
+        const std::uint32_t frame {nextCheckpoint};
+        nextCheckpoint += checkpointInterval;
+        if (frame + maxRollback < current) continue; // its snapshot is gone (only while disconnected)
+
+        const std::uint8_t* ram {frame == current ? machine.pacman.memory() : states[frame % (maxRollback + 1)].hardware.ram};
+        latest = {frame, hash64(ram, Pacman::ramSize)};
+        check(true, latest);
+    }
+}
+
+void Netplay::check(const bool mine, const Checksum checksum)
+{
+    Checksum& slot {(mine ? ownChecksums : peerChecksums)[checksum.frame / checkpointInterval % checksums]};
+    if (checksum.frame == 0 or slot.frame == checksum.frame) return;
+    slot = checksum;
+
+    const Checksum& other {(mine ? peerChecksums : ownChecksums)[checksum.frame / checkpointInterval % checksums]};
+    if (other.frame == checksum.frame and other.hash != checksum.hash and desyncs++ == 0)
+        SDL_Log("netplay: desync, ram differs from the other player's at frame %u.\n", checksum.frame);
+}
+
+void Netplay::sendHello()
+{
+    std::vector<std::uint8_t> packet;
+    put(packet, magic, 4);
+    put(packet, hello, 1);
+    put(packet, protocolVersion, 1);
+    put(packet, static_cast<std::uint64_t>(player), 1);
+    put(packet, dipswitch, 1);
+    put(packet, romHash, 8);
+    put(packet, graphicsHash, 8);
+    send(std::move(packet));
+    lastHello = std::chrono::steady_clock::now();
+}
+
+void Netplay::sendInputs()
+{
+    if (!peerKnown or ended) return;
+
+    const std::uint32_t first {std::max(remoteAck, localFrames - std::min<std::uint32_t>(localFrames, history))};
+    const int advantage {std::clamp(static_cast<int>(current) - static_cast<int>(remoteFrames), -128, 127)};
+
+    std::vector<std::uint8_t> packet;
+    put(packet, magic, 4);
+    put(packet, inputs, 1);
+    put(packet, remoteFrames, 4); // acknowledges the peer's inputs
+    put(packet, static_cast<std::uint8_t>(advantage), 1);
+    put(packet, latest.frame, 4);
+    put(packet, latest.hash, 8);
+    put(packet, first, 4);
+    put(packet, localFrames - first, 1);
+    for (std::uint32_t frame {first}; frame != localFrames; ++frame)
+        put(packet, local[frame % history], 2);
+    send(std::move(packet));
+    lastSent = std::chrono::steady_clock::now();
+}
+
+void Netplay::send(std::vector<std::uint8_t> bytes)
+{
+    if (options.loss != 0 and static_cast<int>(shimRandom() % 100) < options.loss) return;
+
+    const int delay {options.latency + (options.jitter != 0 ? static_cast<int>(shimRandom() % (options.jitter + 1)) : 0)};
+    outgoing.push_back({std::chrono::steady_clock::now() + std::chrono::milliseconds{delay}, std::move(bytes)});
+    flush();
+}
+
+void Netplay::flush()
+{
+    const auto now {std::chrono::steady_clock::now()};
+    for (auto it {outgoing.begin()}; it != outgoing.end();) {
+        if (it->due > now) {
+            ++it;
+            continue;
+        }
+#if defined(_WIN32)
+        sendto(static_cast<SOCKET>(sock), reinterpret_cast<const char*>(it->bytes.data()), static_cast<int>(it->bytes.size()),
+               0, reinterpret_cast<const sockaddr*>(peerAddress), sizeof(sockaddr_in));
+#else
+        sendto(static_cast<int>(sock), it->bytes.data(), it->bytes.size(), 0, reinterpret_cast<const sockaddr*>(peerAddress),
+               sizeof(sockaddr_in));
+#endif
+        it = outgoing.erase(it);
+    }
+}
+
+void Netplay::receive()
+{
+    if (sock == -1) return;
+
+    std::uint8_t buffer[512];
+    for (;;) {
+        sockaddr_in from {};
+        socklen_t fromSize {sizeof(from)};
+#if defined(_WIN32)
+        const int size {recvfrom(static_cast<SOCKET>(sock), reinterpret_cast<char*>(buffer), sizeof(buffer), 0,
+                                 reinterpret_cast<sockaddr*>(&from), &fromSize)};
+#else
+        const auto size {recvfrom(static_cast<int>(sock), buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from),
+                                  &fromSize)};
+#endif
+        if (size <= 0) return;
+
+        // player 1 learns the peer's address from its first hello, then only listens to that peer
+        sockaddr_in peer {};
+        std::memcpy(&peer, peerAddress, sizeof(peer));
+        if (peerKnown and (from.sin_addr.s_addr != peer.sin_addr.s_addr or from.sin_port != peer.sin_port)) continue;
+        if (!peerKnown and size >= 5 and buffer[4] == hello) {
+            std::memcpy(peerAddress, &from, sizeof(from));
+            peerKnown = true;
+        }
+        if (peerKnown) handle(buffer, static_cast<std::size_t>(size));
+    }
+}
+
+void Netplay::handle(const std::uint8_t* data, const std::size_t size)
+{
+    const std::uint8_t* in {data};
+    if (ended or size < 5 or get(in, 4) != magic) return;
+
+    const auto type {static_cast<Type>(get(in, 1))};
+    if (type == hello and size == 24) {
+        const auto version {static_cast<std::uint8_t>(get(in, 1))};
+        const auto theirPlayer {static_cast<int>(get(in, 1))};
+        const auto theirDipswitch {static_cast<std::uint8_t>(get(in, 1))};
+        const std::uint64_t theirRoms {get(in, 8)}, theirGraphics {get(in, 8)};
+        if (version != protocolVersion or theirPlayer == player or theirDipswitch != dipswitch
+            or theirRoms != romHash or theirGraphics != graphicsHash) {
+            if (!rejected) SDL_Log("error: the other player runs different roms, dip switches or player number.\n");
+            rejected = true;
+            return;
+        }
+        if (player == 1) sendHello(); // answer every hello: the first answer may have been lost
+        connected = true;
+        lastReceived = std::chrono::steady_clock::now();
+    } else if (type == inputs and size >= 27 and connected) {
+        lastReceived = std::chrono::steady_clock::now();
+        remoteAck = std::clamp(static_cast<std::uint32_t>(get(in, 4)), remoteAck, localFrames);
+        remoteAdvantage = static_cast<std::int8_t>(get(in, 1));
+        const auto checksumFrame {static_cast<std::uint32_t>(get(in, 4))};
+        check(false, {checksumFrame, get(in, 8)});
+
+        const auto first {static_cast<std::uint32_t>(get(in, 4))};
+        const auto count {static_cast<std::uint32_t>(get(in, 1))};
+        if (size != 27 + count * 2) return;
+
+        // take the inputs that continue the confirmed ones, noting any frame that already ran on a wrong guess
+        for (std::uint32_t frame {first}; frame != first + count; ++frame) {
+            const auto input {static_cast<std::uint16_t>(get(in, 2))};
+            if (frame != remoteFrames) continue;
+            remote[frame % history] = input;
+            if (frame < current and simulated[frame % history] != input) mispredicted = std::min(mispredicted, frame);
+            ++remoteFrames;
+        }
+    }
+}
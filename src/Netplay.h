@@ -0,0 +1,204 @@
+#ifndef PACMAN_NETPLAY_H
+#define PACMAN_NETPLAY_H
+
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "Machine.h"
+
+/**
+ * Two player games over UDP with rollback. Each peer sends its own inputs for every frame, delayed by a few frames,
+ * and runs ahead on a prediction of the other's (the last inputs it confirmed). When a prediction turns out wrong
+ * the machine is restored to the snapshot taken before that frame and the frames since are run again, headless,
+ * with the inputs now known, all within the frame being advanced. Packets repeat every input the peer hasn't
+ * acknowledged, so a lost packet costs nothing but a later correction.
+ *
+ * Both peers start from a freshly constructed machine with the same roms and dip switch (checked on connection),
+ * and stay identical because the machine is deterministic: the joystick belongs to whoever's turn it is, the other
+ * buttons to both players. A hash of ram every checkpointInterval frames is exchanged to report desyncs.
+ */
+class Netplay {
+public:
+    struct Options {
+        std::string peer; // "host:port" to join as player 2, or empty to wait for a peer as player 1
+        int port {7000}; // the port to wait on (player 1) or to send from (player 2, 0 for any)
+        int inputDelay {2}; // frames between reading a peer's keys and the frame they apply to [0,maxInputDelay]
+        int latency {0}; // milliseconds every outgoing packet is held back, to test on one host
+        int jitter {0}; // up to this many more milliseconds, at random (packets may arrive out of order)
+        int loss {0}; // percentage of outgoing packets dropped
+    };
+
+    static constexpr int maxRollback {8}; // most frames run ahead of the peer's confirmed inputs
+    static constexpr int maxInputDelay {8};
+    static constexpr int checkpointInterval {60};
+
+    /**
+     * Constructor (also sets the active boolean). Opens the socket; connect() finds the peer.
+     * @param assets the roms and decoded graphics (hashed to check the peer runs the same game)
+     * @param ds the dip switch settings
+     * @param options the session settings
+     */
+    Netplay(const Assets& assets, std::uint8_t ds, Options options);
+
+    // Closes the socket.
+    ~Netplay();
+
+    Netplay(const Netplay&) = delete;
+    Netplay& operator=(const Netplay&) = delete;
+
+    /**
+     * Waits until the peer has answered the handshake.
+     * @param timeout how long to wait
+     * @return true if connected; false on timeout or a mismatched peer
+     */
+    bool connect(std::chrono::milliseconds timeout);
+
+    /**
+     * Runs the next frame with this peer's keys, first rolling back and replaying any frames whose prediction was
+     * wrong. Does nothing and returns false if the peer is too far behind (or this one too far ahead), in which case
+     * the caller should wait a moment and try again with the keys then held.
+     * @param machine the session's machine (only ever advanced through this object)
+     * @param keys this peer's inputs, IN1 << 8 | IN0 (active low)
+     * @return true if a frame was run; false otherwise
+     */
+    bool advance(Machine& machine, std::uint16_t keys);
+
+    /**
+     * Ends the session: keeps exchanging packets until every frame run so far is confirmed on both sides, and
+     * corrects the machine if needed, so both peers stop in the same state.
+     * @param machine the session's machine
+     * @param timeout how long to wait for the peer
+     * @return true if everything was confirmed; false on timeout
+     */
+    bool finish(Machine& machine, std::chrono::milliseconds timeout);
+
+    // True if the socket was opened successfully; false otherwise.
+    bool active {false};
+
+    // Is the peer answering? (false before connect and after a timeout, which ends the session: from then on the
+    // peer's packets are ignored, none are sent to it and its inputs are idle)
+    bool connected {false};
+
+    // totals since construction
+    std::uint64_t rollbacks {0};
+    std::uint64_t resimulatedFrames {0};
+    std::uint64_t stalls {0};
+    std::uint64_t desyncs {0};
+private:
+    static constexpr int history {64}; // inputs kept per peer (ring indexed by frame)
+    static constexpr int checksums {16}; // checkpoint hashes kept per peer
+    static constexpr std::uint32_t magic {0x504E4D31}; // "PNM1"
+    static constexpr std::uint8_t protocolVersion {2};
+    static constexpr auto disconnectTimeout {std::chrono::seconds{5}};
+    static constexpr auto helloInterval {std::chrono::milliseconds{100}};
+    static constexpr auto resendInterval {std::chrono::milliseconds{8}}; // while stalled or finishing
+    static constexpr std::uint32_t stallSpacing {8}; // fewest frames between stalls that only even out the pace
+
+    enum Type : std::uint8_t { hello = 1, inputs = 2 };
+
+    struct Checksum {
+        std::uint32_t frame; // the hash is of ram at the start of this frame (0: none yet)
+        std::uint64_t hash;
+    };
+
+    struct Delayed {
+        std::chrono::steady_clock::time_point due;
+        std::vector<std::uint8_t> bytes;
+    };
+
+    // Sends the hello packet (handshake).
+    void sendHello();
+
+    // Sends every input the peer hasn't acknowledged, the frame advantage and the latest checkpoint.
+    void sendInputs();
+
+    /**
+     * Sends a packet through the latency shim.
+     * @param bytes the packet
+     */
+    void send(std::vector<std::uint8_t> bytes);
+
+    // Sends the delayed packets that are due.
+    void flush();
+
+    // Reads every waiting packet.
+    void receive();
+
+    /**
+     * Handles one packet.
+     * @param data the packet
+     * @param size its size in bytes
+     */
+    void handle(const std::uint8_t* data, std::size_t size);
+
+    /**
+     * Records a checkpoint hash and compares it with the peer's.
+     * @param mine true for this peer's hash, false for the peer's
+     * @param checksum the hash and its frame
+     */
+    void check(bool mine, Checksum checksum);
+
+    /**
+     * Restores the machine to the earliest mispredicted frame and runs it back up to the current one.
+     * @param machine the session's machine
+     */
+    void rollback(Machine& machine);
+
+    /**
+     * Runs a frame with both peers' inputs (saving the state at its start for rollbacks).
+     * @param machine the session's machine, at the start of the frame
+     * @param frame the session frame
+     */
+    void step(Machine& machine, std::uint32_t frame);
+
+    /**
+     * The peer's input for a frame.
+     * @param frame the session frame
+     * @return the confirmed input, or a prediction: the last confirmed one (idle while disconnected)
+     */
+    [[nodiscard]] std::uint16_t remoteInput(std::uint32_t frame) const;
+
+    /**
+     * Hashes ram at the checkpoints whose inputs have all been confirmed.
+     * @param machine the session's machine
+     */
+    void checkpoint(const Machine& machine);
+
+    const Options options;
+    const int player; // 1 or 2
+    std::uint64_t romHash {}, graphicsHash {};
+    std::uint8_t dipswitch {};
+
+    std::intptr_t sock {-1};
+    std::uint8_t peerAddress[16] {}; // the peer's IPv4 sockaddr
+    bool peerKnown {false}, rejected {false}, ended {false};
+    std::chrono::steady_clock::time_point lastReceived {}, lastHello {}, lastSent {};
+
+    // inputs by frame: this peer's, the peer's confirmed ones, and the peer's as last simulated
+    std::uint16_t local[history] {}, remote[history] {}, simulated[history] {};
+    std::uint32_t current {0}; // the next frame to run
+    std::uint32_t localFrames {0}; // this peer's inputs are known below this frame
+    std::uint32_t remoteFrames {0}; // the peer's inputs are confirmed below this frame
+    std::uint32_t remoteAck {0}; // the peer has this peer's inputs below this frame
+    std::uint32_t mispredicted {UINT32_MAX}; // earliest frame simulated with a wrong prediction
+    int remoteAdvantage {0}; // how many frames the peer says it runs ahead of this peer's confirmed inputs
+    std::uint32_t sinceStall {0}; // frames run since the last stall
+
+    // snapshots at the start of the last frames (ring indexed by frame)
+    Machine::State states[maxRollback + 1] {};
+
+    Checksum ownChecksums[checksums] {}, peerChecksums[checksums] {};
+    Checksum latest {}; // this peer's newest checkpoint, sent with every packet
+    std::uint32_t nextCheckpoint {checkpointInterval};
+
+    // latency shim
+    std::deque<Delayed> outgoing;
+    std::mt19937 shimRandom {0x5EED};
+};
+
+
+#endif //PACMAN_NETPLAY_H
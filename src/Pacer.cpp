@@ -0,0 +1,35 @@
+#include "Pacer.h"
+#include <algorithm>
+#include <thread>
+
+Pacer::Pacer(const Clock::duration period) : period{period}, deadline{Clock::now() + period} {}
+
+bool Pacer::wait()
+{
+    const Clock::time_point due {deadline};
+    deadline += period;
+
+    Clock::time_point now {Clock::now()};
+    if (now >= due) return false;
+
+    if (due - now > slack) {
+        const Clock::time_point wake {due - slack};
+        std::this_thread::sleep_until(wake);
+        now = Clock::now();
+
+        // keep twice the worst recent oversleep in reserve, letting it shrink back slowly once wakeups are prompt
+        const Clock::duration late {now - wake};
+        slack = std::clamp(std::max(2 * late, slack - slack / 32), minSlack, period);
+    }
+
+    while (now < due) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    return true;
+}
+
+void Pacer::reset()
+{
+    deadline = Clock::now() + period;
+}
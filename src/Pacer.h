@@ -0,0 +1,41 @@
+#ifndef PACMAN_PACER_H
+#define PACMAN_PACER_H
+
+
+#include <chrono>
+
+/**
+ * Paces a loop to a fixed period with nanosecond deadlines. Each deadline is the previous one plus the period, never
+ * "now" plus the period, so the rate doesn't drift no matter how late individual ticks wake. Waiting sleeps until
+ * shortly before the deadline and spins the rest of the way; how early it stops sleeping follows how late the OS
+ * has been waking it, so hosts with coarse timers spin longer and precise ones barely at all.
+ */
+class Pacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Constructor. The first deadline is one period from now.
+     * @param period the time between deadlines
+     */
+    explicit Pacer(Clock::duration period);
+
+    /**
+     * Waits for the current deadline and moves it on by one period.
+     * @return true if the deadline was waited for; false if it had already passed (nothing was waited for)
+     */
+    bool wait();
+
+    // Gives up on late deadlines: the next one is one period from now.
+    void reset();
+
+    const Clock::duration period;
+private:
+    static constexpr Clock::duration minSlack {std::chrono::microseconds{100}};
+
+    Clock::time_point deadline;
+    Clock::duration slack {std::chrono::milliseconds{1}}; // how long before a deadline sleeping stops and spinning starts
+};
+
+
+#endif //PACMAN_PACER_H
@@ -1,77 +1,103 @@
 #include "Pacman.h"
-#include <fstream>
-#include <iostream>
-
-/**
- * For loading a binary ROM file.
- * @param array a pointer to where to dump the file's contents
- * @param path path to the file
- * @param addr base address to start reading the file from
- * @param sz size of the array
- * @return true if there were no errors opening/reading the file; false otherwise
- */
-bool load(std::uint8_t* array, const std::string& path, const int addr, const int sz)
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iterator>
+#include "TileMap.h"
+
+template<class Trace>
+BasicPacman<Trace>::BasicPacman(const std::uint8_t ds, const bool headless) : BasicPacman{Assets::load("roms/"), ds, headless} {}
+
+template<class Trace>
+BasicPacman<Trace>::BasicPacman(std::shared_ptr<const Assets> assets, const std::uint8_t ds, const bool headless)
+    : headless{headless}, dipswitch{ds}, assets{std::move(assets)}
 {
-    std::ifstream file {path, std::ios::binary};
+    setFrameBuffer(nullptr);
+    active &= this->assets != nullptr;
+    if (active) rom = this->assets->rom;
+    mapPages();
+    if (active and !headless) active &= initVideo();
+}
 
-    if (!file.is_open()) {
-        SDL_Log("error: can't open file '%s'.\n", path.c_str());
-        return false;
+template<class Trace>
+void BasicPacman<Trace>::setFrameBuffer(std::uint32_t* buffer)
+{
+    if (buffer == nullptr) {
+        frameStorage.assign(screenWidth * screenHeight, 0);
+        buffer = frameStorage.data();
+    } else {
+        frameStorage = {};
     }
+    rasterBuffer = reinterpret_cast<std::uint32_t (*)[screenWidth]>(buffer);
+    fullRedraw = true;
+}
 
-    file.read(reinterpret_cast<char*>(array) + addr, sz);
+template<class Trace>
+void BasicPacman<Trace>::save(Snapshot& snapshot) const
+{
+    snapshot.wsg = wsg;
+    std::memcpy(snapshot.spritePos, spritePos, sizeof(spritePos));
+    snapshot.input0 = input0;
+    snapshot.input1 = input1;
+    snapshot.interruptVector = interruptVector;
+    snapshot.interruptEnabled = interruptEnabled;
+    snapshot.soundEnabled = soundEnabled;
+    snapshot.flipScreen = flipScreen;
+    std::memcpy(snapshot.ram, ram, sizeof(ram));
+}
 
-    if (file.bad()) {
-        SDL_Log("error [errno=%d]: failed when reading file '%s'.\n", errno, path.c_str());
-        return false;
-    }
+template<class Trace>
+void BasicPacman<Trace>::restore(const Snapshot& snapshot, const bool redraw)
+{
+    wsg = snapshot.wsg;
+    std::memcpy(spritePos, snapshot.spritePos, sizeof(spritePos));
+    input0 = snapshot.input0;
+    input1 = snapshot.input1;
+    interruptVector = snapshot.interruptVector;
+    interruptEnabled = snapshot.interruptEnabled;
+    soundEnabled = snapshot.soundEnabled;
+    flipScreen = snapshot.flipScreen;
+    std::memcpy(ram, snapshot.ram, sizeof(ram));
+    fullRedraw |= redraw;
+}
 
-    return true;
+template<class Trace>
+void BasicPacman<Trace>::capture(Video& video) const
+{
+    std::memcpy(video.tiles, ram, sizeof(video.tiles));
+    std::memcpy(video.sprites, ram + 0xFF0, sizeof(video.sprites));
+    std::memcpy(video.spritePos, spritePos, sizeof(spritePos));
+    video.flipScreen = flipScreen;
 }
 
-/**
- * Decodes a strip of pixels for a tile or sprite. The word 'image' here refers to either a tile or sprite.
- * @param rom pointer to array of bytes
- * @param array where to put the decoded pixels
- * @param imageNum how many images have been decoded before this call (i.e. 0, 1, 2, ..., n)
- * @param stripNum how many strips have been decoded before this call (i.e. 0, 1, 2, ..., n)
- * @param pitch how many pixels per row in the image
- * @param x the coordinate of the strip's top-left corner on the x-axis
- * @param y the coordinate of the strip's top left corner on the y-axis
- */
-void decodeStrip(const std::uint8_t* rom, std::uint8_t* array, const int imageNum, const int stripNum, const int pitch, const int x, const int y)
+template<class Trace>
+void BasicPacman<Trace>::show(const Video& video)
 {
-    for (int j {0}; j != 8; ++j) {
-        const std::uint8_t byte {rom[j + (stripNum * 8) + (imageNum * pitch * (pitch / 8 * 2))]};
-        const int xBase {(y * pitch * 4) + ((x + 1) * 8 - 1) - j};
-
-        array[xBase + pitch * 3] = ((byte & 0x10) >> 3U) | ((byte & 0x01U) >> 0U);
-        array[xBase + pitch * 2] = ((byte & 0x20) >> 4U) | ((byte & 0x02U) >> 1U);
-        array[xBase + pitch * 1] = ((byte & 0x40) >> 5U) | ((byte & 0x04U) >> 2U);
-        array[xBase + pitch * 0] = ((byte & 0x80) >> 6U) | ((byte & 0x08U) >> 3U);
-    }
+    std::memcpy(ram, video.tiles, sizeof(video.tiles));
+    std::memcpy(ram + 0xFF0, video.sprites, sizeof(video.sprites));
+    std::memcpy(spritePos, video.spritePos, sizeof(spritePos));
+    flipScreen = video.flipScreen;
 }
 
-Pacman::Pacman(const std::uint8_t ds) : dipswitch{ds}
+template<class Trace>
+void BasicPacman<Trace>::mapPages()
 {
-    const std::string dir {"roms/"};
-    active &= load(rom, dir + "pacman.6e", 0, 0x1000);
-    active &= load(rom, dir + "pacman.6f", 0x1000, 0x1000);
-    active &= load(rom, dir + "pacman.6h", 0x2000, 0x1000);
-    active &= load(rom, dir + "pacman.6j", 0x3000, 0x1000);
-    if (active) active &= initVideo();
-    if (active) active &= preload(dir);
+    // 0x0000-0x7FFF is mirrored at 0x8000-0xFFFF (A15 is not decoded)
+    for (int page {0}; page != 0x100; ++page) {
+        const int base {(page & 0x7F) << 8};
+        // without roms (the board is inactive) rom reads fall through to readRegister and read 0xFF
+        const std::uint8_t* romPage {rom != nullptr ? rom + base : nullptr};
+        readPages[page] = base < 0x4000 ? romPage : base < 0x5000 ? ram + (base - 0x4000) : nullptr;
+        writePages[page] = base >= 0x4000 and base < 0x5000 ? ram + (base - 0x4000) : nullptr;
+    }
 }
 
-std::uint8_t Pacman::read8(std::uint16_t addr) const
+template<class Trace>
+std::uint8_t BasicPacman<Trace>::readRegister(std::uint16_t addr) const
 {
     addr &= 0x7FFFU;
 
-    if (addr < 0x4000) {
-        return rom[addr];
-    } else if (addr < 0x5000) {
-        return ram[addr - 0x4000];
-    } else if (addr < 0x5100) { // Memory Mapped Registers
+    if (0x5000 <= addr and addr < 0x5100) { // Memory Mapped Registers
         /**
          * Read registers not used in Pac-Man
          * 0x5004: 1 player start lamp
@@ -89,21 +115,20 @@ std::uint8_t Pacman::read8(std::uint16_t addr) const
         } else if (addr < 0x50C0) { // Dip Switch Settings
             return dipswitch;
         }
-    } else {
+    } else if constexpr (logBadAccess) {
         SDL_Log("error: attempt to read at %04X\n", addr);
     }
     return 0xFF;
 }
 
-void Pacman::write8(std::uint16_t addr, const std::uint8_t val)
+template<class Trace>
+void BasicPacman<Trace>::writeRegister(std::uint16_t addr, const std::uint8_t val)
 {
     addr &= 0x7FFFU;
 
     if (addr < 0x4000) {
-        SDL_Log("error: attempt to write to rom %02X at %04X\n", val, addr);
-    } else if (addr < 0x5000) {
-        ram[addr - 0x4000] = val;
-    } else if (addr < 0x5100) { // Memory Mapped Registers
+        if constexpr (logBadAccess) SDL_Log("error: attempt to write to rom %02X at %04X\n", val, addr);
+    } else if (0x5000 <= addr and addr < 0x5100) { // Memory Mapped Registers
         /**
          * Write registers not used in Pac-Man:
          * 0x5002: ??? Aux board enable?
@@ -111,7 +136,6 @@ void Pacman::write8(std::uint16_t addr, const std::uint8_t val)
          * 0x5005: 2 player start lamp
          * 0x5006: Coin lockout
          * 0x5007: Coin Counter
-         * 0x5040-0x5060: TODO sound
          * 0x50C0-0x5100: Watchdog reset
          */
 
@@ -121,115 +145,230 @@ void Pacman::write8(std::uint16_t addr, const std::uint8_t val)
             soundEnabled = val & 0b1;
         } else if (addr == 0x5003) { // Flip screen
             flipScreen = val & 0b1;
+        } else if (0x503F < addr and addr < 0x5060) { // Sound registers
+            wsg.write(addr - 0x5040, val);
         }  else if (0x505F < addr and addr < 0x5070) {
             spritePos[addr - 0x5060] = val;
         }
-    } else {
+    } else if constexpr (logBadAccess) {
         SDL_Log("error: attempt to write %02X at %04X\n", val, addr);
     }
 }
 
-void Pacman::onKeyDown(SDL_Scancode scancode)
+template<class Trace>
+void BasicPacman<Trace>::onKeyDown(SDL_Scancode scancode)
 {
     switch (scancode) {
-        case SDL_SCANCODE_UP: input0 &= ~up; input1 &= ~up; break;
-        case SDL_SCANCODE_LEFT: input0 &= ~left; input1 &= ~left; break;
-        case SDL_SCANCODE_RIGHT: input0 &= ~right; input1 &= ~right; break;
-        case SDL_SCANCODE_DOWN: input0 &= ~down; input1 &= ~down; break;
-        case SDL_SCANCODE_1: input0 &= ~coin1; break;
-        case SDL_SCANCODE_RETURN: input1 &= ~onePlayer; break;
-        case SDL_SCANCODE_2: input0 &= ~coin2; break;
-        case SDL_SCANCODE_P: input1 &= ~twoPlayer; break;
-        case SDL_SCANCODE_C: input0 &= ~credit; break;
+        case SDL_SCANCODE_UP: keyInput0 &= ~up; keyInput1 &= ~up; break;
+        case SDL_SCANCODE_LEFT: keyInput0 &= ~left; keyInput1 &= ~left; break;
+        case SDL_SCANCODE_RIGHT: keyInput0 &= ~right; keyInput1 &= ~right; break;
+        case SDL_SCANCODE_DOWN: keyInput0 &= ~down; keyInput1 &= ~down; break;
+        case SDL_SCANCODE_1: keyInput0 &= ~coin1; break;
+        case SDL_SCANCODE_RETURN: keyInput1 &= ~onePlayer; break;
+        case SDL_SCANCODE_2: keyInput0 &= ~coin2; break;
+        case SDL_SCANCODE_P: keyInput1 &= ~twoPlayer; break;
+        case SDL_SCANCODE_C: keyInput0 &= ~credit; break;
         default: break;
     }
 }
 
-void Pacman::onKeyUp(SDL_Scancode scancode)
+template<class Trace>
+void BasicPacman<Trace>::onKeyUp(SDL_Scancode scancode)
 {
     switch (scancode) {
-        case SDL_SCANCODE_UP: input0 |= up; input1 |= up; break;
-        case SDL_SCANCODE_LEFT: input0 |= left; input1 |= left; break;
-        case SDL_SCANCODE_RIGHT: input0 |= right; input1 |= right; break;
-        case SDL_SCANCODE_DOWN: input0 |= down; input1 |= down; break;
-        case SDL_SCANCODE_SPACE: input0 ^= rackAdvance; break; // switch 0=on, 1=off
-        case SDL_SCANCODE_T: input1 ^= test; break; // switch 0=on, 1=off
-        case SDL_SCANCODE_1: input0 |= coin1; break;
-        case SDL_SCANCODE_RETURN: input1 |= onePlayer; break;
-        case SDL_SCANCODE_2: input0 |= coin2; break;
-        case SDL_SCANCODE_P: input1 |= twoPlayer; break;
-        case SDL_SCANCODE_C: input0 |= credit; break;
+        case SDL_SCANCODE_UP: keyInput0 |= up; keyInput1 |= up; break;
+        case SDL_SCANCODE_LEFT: keyInput0 |= left; keyInput1 |= left; break;
+        case SDL_SCANCODE_RIGHT: keyInput0 |= right; keyInput1 |= right; break;
+        case SDL_SCANCODE_DOWN: keyInput0 |= down; keyInput1 |= down; break;
+        case SDL_SCANCODE_SPACE: keyInput0 ^= rackAdvance; break; // switch 0=on, 1=off
+        case SDL_SCANCODE_T: keyInput1 ^= test; break; // switch 0=on, 1=off
+        case SDL_SCANCODE_1: keyInput0 |= coin1; break;
+        case SDL_SCANCODE_RETURN: keyInput1 |= onePlayer; break;
+        case SDL_SCANCODE_2: keyInput0 |= coin2; break;
+        case SDL_SCANCODE_P: keyInput1 |= twoPlayer; break;
+        case SDL_SCANCODE_C: keyInput0 |= credit; break;
         default: break;
     }
 }
 
-void Pacman::drawTile(const int loc, const int x, const int y)
+template<class Trace>
+void BasicPacman<Trace>::drawBand(const int ty, const std::uint32_t columns, const ScanSprite* sprites,
+                                  const std::uint8_t* lineSprites)
 {
-    const Tile& tile {tiles[ram[loc]]};
-    const Palette& palette {palettes[ram[loc + 0x400] & 0x3F]};
+    constexpr int tileColumns {screenWidth / 8};
+
+    // look the row's tiles up once (a flipped screen shows tile 27 - tx, 35 - ty there, turned 180 degrees)
+    const std::uint32_t* tiles[tileColumns];
+    std::uint32_t expanded[tileColumns][64]; // tiles another thread is expanding in the cache right now
+    const int sourceRow {flipScreen ? screenHeight / 8 - 1 - ty : ty};
+    for (std::uint32_t bits {columns}; bits != 0; bits &= bits - 1) {
+        const int tx {std::countr_zero(bits)};
+        const int loc {tileMap.loc[sourceRow][flipScreen ? tileColumns - 1 - tx : tx]};
+        const int tileNum {ram[loc]}, paletteNum {ram[loc + 0x400] & 0x3F};
+        tiles[tx] = assets->cache->tile(tileNum, paletteNum);
+        if (tiles[tx] == nullptr) {
+            expandTile(*assets, tileNum, paletteNum, expanded[tx]);
+            tiles[tx] = expanded[tx];
+        }
+    }
 
     for (int i {0}; i != 8; ++i) {
-        for (int j {0}; j != 8; ++j)
-            rasterBuffer[y*8 + i][x*8 + j] = palette[tile[j + (i << 3)]];
-    }
-}
+        std::uint32_t* line {rasterBuffer[ty * 8 + i]};
+
+        for (std::uint32_t bits {columns}; bits != 0; bits &= bits - 1) {
+            const int tx {std::countr_zero(bits)};
+            if (!flipScreen) {
+                blitTileRow(line + tx * 8, tiles[tx] + i * 8);
+            } else {
+                const std::uint32_t* src {tiles[tx] + (7 - i) * 8};
+                for (int j {0}; j != 8; ++j)
+                    line[tx * 8 + j] = src[7 - j];
+            }
+        }
 
-void Pacman::drawSprite(const int loc, const int x, const int y)
-{
-    if (x > screenWidth) return;
-    const std::uint8_t byte0 {ram[loc]}; // upper 6 bits are the sprite #, bit 1 is flip-x, bit 0 is flip-y
-    const Sprite& sprite {sprites[byte0 >> 2]};
-    const Palette& palette {palettes[ram[loc + 1] & 0x3F]};
-    const bool flipX {static_cast<bool>(byte0 & 0b10)};
-    const bool flipY {static_cast<bool>(byte0 & 0b01)};
-
-    for (int i {0}; i != 16; ++i) {
-        for (int j {0}; j != 16; ++j) {
-            const std::uint32_t color {palette[sprite[j + (i << 4)]]};
-            const int xCoord {x + (flipX ? 15 - j : j)};
-            const int yCoord {y + (flipY ? 15 - i : i)};
-
-            if (color == black or xCoord < 0 or xCoord >= screenWidth)
-                continue;
-
-            rasterBuffer[yCoord][xCoord] = color;
+        // sprites in reverse order so the first one ends up on top
+        for (unsigned bits {lineSprites[i]}; bits != 0;) {
+            const int n {static_cast<int>(std::bit_width(bits)) - 1};
+            bits &= ~(1U << n);
+
+            const ScanSprite& sprite {sprites[n]};
+            const int row {ty * 8 + i - sprite.y};
+            const int j0 {std::max(0, -sprite.x)}, j1 {std::min(16, screenWidth - sprite.x)};
+            const auto clip {static_cast<std::uint16_t>((0xFFFFU << j0) & (0xFFFFU >> (16 - j1)))};
+            const auto mask {static_cast<std::uint16_t>(sprite.masks[row] & clip)};
+            if (mask != 0) blitSpriteRow(line, sprite.x, sprite.pixels + row * 16, mask, clip != 0xFFFF);
         }
     }
 }
 
-void Pacman::draw()
+template<class Trace>
+void BasicPacman<Trace>::render()
 {
-    // bottom of screen
-    for (int y {0}; y != 2; ++y) {
-        for (int x {2}; x != 30; ++x)
-            drawTile(x + (y * 32), 29 - x, y + 34);
+    const Profiler::Scope scope {profiler, Profiler::raster};
+    constexpr int tileRows {screenHeight / 8};
+
+    // this frame's sprites on screen (a flipped screen turns them 180 degrees with everything else)
+    ScanSprite sprites[8];
+    std::uint32_t expanded[8][256]; // sprites another thread is expanding in the cache right now
+    std::uint16_t expandedMasks[8][16];
+    for (int i {0}; i != 8; ++i) {
+        const std::uint8_t byte0 {ram[0xFF0 + i * 2]}; // upper 6 bits are the sprite #, bit 1 is flip-x, bit 0 is flip-y
+        const int paletteNum {ram[0xFF1 + i * 2] & 0x3F};
+        const int flip {flipScreen ? (byte0 & 0b11) ^ 0b11 : byte0 & 0b11};
+        ScanSprite& sprite {sprites[i]};
+        sprite.x = screenWidth - spritePos[i * 2] + 15;
+        sprite.y = screenHeight - spritePos[i * 2 + 1] - 16;
+        if (flipScreen) {
+            sprite.x = screenWidth - 16 - sprite.x;
+            sprite.y = screenHeight - 16 - sprite.y;
+        }
+        sprite.pixels = assets->cache->sprite(byte0 >> 2, paletteNum, flip, sprite.masks);
+        if (sprite.pixels == nullptr) {
+            expandSprite(*assets, byte0 >> 2, paletteNum, flip, expanded[i], expandedMasks[i]);
+            sprite.pixels = expanded[i];
+            sprite.masks = expandedMasks[i];
+        }
     }
 
-    // middle of screen
-    for (int x {0}; x != 28; ++x) {
-        for (int y {0}; y != 32; ++y)
-            drawTile(64 + y + (x * 32), 27 - x, y + 2);
+    // tile columns to redraw in each tile row (bit tx of dirty[ty])
+    std::uint32_t dirty[tileRows] {};
+    const auto markSprite {[&dirty](const int x, const int y) {
+        if (x >= screenWidth or x + 16 <= 0) return;
+        const int x0 {std::max(x, 0) / 8}, x1 {std::min(x + 15, screenWidth - 1) / 8};
+        const int y0 {std::max(y, 0) / 8}, y1 {std::min(y + 15, screenHeight - 1) / 8};
+        for (int ty {y0}; ty <= y1; ++ty)
+            dirty[ty] |= (2U << x1) - (1U << x0);
+    }};
+
+    if (fullRedraw or flipScreen != renderedFlip) {
+        std::fill(std::begin(dirty), std::end(dirty), (1U << screenWidth / 8) - 1);
+        fullRedraw = false;
+        renderedFlip = flipScreen;
+    } else {
+        // tiles whose video or color ram changed since the last render, 8 at a time
+        for (int loc {0}; loc != 0x400; loc += 8) {
+            std::uint64_t video, color, renderedVideo, renderedColor;
+            std::memcpy(&video, ram + loc, 8);
+            std::memcpy(&color, ram + 0x400 + loc, 8);
+            std::memcpy(&renderedVideo, renderedTiles + loc, 8);
+            std::memcpy(&renderedColor, renderedTiles + 0x400 + loc, 8);
+            if (((video ^ renderedVideo) | (color ^ renderedColor)) == 0) continue;
+
+            for (int i {loc}; i != loc + 8; ++i) {
+                if ((ram[i] != renderedTiles[i] or ram[i + 0x400] != renderedTiles[i + 0x400]) and tileMap.x[i] != -1) {
+                    const int tx {flipScreen ? screenWidth / 8 - 1 - tileMap.x[i] : tileMap.x[i]};
+                    const int ty {flipScreen ? tileRows - 1 - tileMap.y[i] : tileMap.y[i]};
+                    dirty[ty] |= 1U << tx;
+                }
+            }
+        }
+
+        // erase last frame's sprites and clear the background of this frame's
+        for (int i {0}; i != 8; ++i) {
+            markSprite(spriteRects[i][0], spriteRects[i][1]);
+            markSprite(sprites[i].x, sprites[i].y);
+        }
     }
+    std::memcpy(renderedTiles, ram, sizeof(renderedTiles));
 
-    // top of screen
-    for (int y {0}; y != 2; ++y) {
-        for (int x {2}; x != 30; ++x)
-            drawTile(960 + x + (y * 32), 29 - x, y);
+    // which sprites cover each line, like the hardware's line buffer
+    std::uint8_t lineSprites[screenHeight] {};
+    for (int i {0}; i != 8; ++i) {
+        spriteRects[i][0] = sprites[i].x;
+        spriteRects[i][1] = sprites[i].y;
+        if (sprites[i].x >= screenWidth or sprites[i].x + 16 <= 0) continue;
+        for (int y {std::max(sprites[i].y, 0)}; y < std::min(sprites[i].y + 16, screenHeight); ++y)
+            lineSprites[y] |= 1U << i;
     }
 
-    // sprites (drawn in reverse order)
-    for (int i {7}; i != -1; --i) {
-        const int n {i * 2}; // step by 2
-        drawSprite(n + 0xFF0, screenWidth - spritePos[n] + 15, screenHeight - spritePos[n + 1] - 16);
+    for (int ty {0}; ty != tileRows; ++ty) {
+        if (dirty[ty] != 0) drawBand(ty, dirty[ty], sprites, lineSprites + ty * 8);
     }
+}
 
-    SDL_UpdateTexture(texture, nullptr, rasterBuffer, pitch);
+template<class Trace>
+void BasicPacman<Trace>::present()
+{
+    if (headless) return;
+
+    const std::uint32_t* pixels {&rasterBuffer[0][0]};
+    int bytes {pitch};
+    if (filter != nullptr) {
+        const Profiler::Scope scope {profiler, Profiler::filter};
+        pixels = filter->apply(pixels);
+        bytes = filter->outputWidth() * static_cast<int>(sizeof(std::uint32_t));
+    }
+    {
+        const Profiler::Scope scope {profiler, Profiler::upload};
+        SDL_UpdateTexture(texture, nullptr, pixels, bytes);
+    }
+    const Profiler::Scope scope {profiler, Profiler::present};
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
 }
 
-bool Pacman::initVideo()
+template<class Trace>
+bool BasicPacman<Trace>::setFilter(Filter* filter)
+{
+    this->filter = filter;
+    if (headless) return true;
+
+    // the filtered frame is scaled to the logical size like an unfiltered one
+    const int width {filter != nullptr ? filter->outputWidth() : screenWidth};
+    const int height {filter != nullptr ? filter->outputHeight() : screenHeight};
+    if (texture != nullptr) SDL_DestroyTexture(texture);
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (!texture) {
+        SDL_Log("SDL_CreateTexture() failed. SDL_Error: %s\n", SDL_GetError());
+        this->filter = nullptr;
+        return active = false;
+    }
+    return true;
+}
+
+template<class Trace>
+bool BasicPacman<Trace>::initVideo()
 {
     // display contents
     window = SDL_CreateWindow(
@@ -269,7 +408,8 @@ bool Pacman::initVideo()
 }
 
 
-void Pacman::off()
+template<class Trace>
+void BasicPacman<Trace>::off()
 {
     if (texture != nullptr) SDL_DestroyTexture(texture);
     texture = nullptr;
@@ -279,61 +419,6 @@ void Pacman::off()
     window = nullptr;
 }
 
-bool Pacman::preload(const std::string& dir)
-{
-    std::uint8_t colorRom[0x20] {};
-    std::uint8_t paletteRom[0x100] {};
-    std::uint8_t tileRom[0x1000] {};
-    std::uint8_t spriteRom[0x1000] {};
-
-    // load the color, palette, tile and sprite roms
-    if (!(load(colorRom, dir + "82s123.7f", 0, 0x20)
-            and load(paletteRom, dir + "82s126.4a", 0, 0x100)
-            and load(tileRom, dir + "pacman.5e", 0, 0x1000)
-            and load(spriteRom, dir + "pacman.5f", 0, 0x1000)))
-        return false;
-
-    // decode palettes
-    for (int i {0}; i != palettes.size(); ++i) {
-        Palette& palette {palettes[i]};
-        for (int j {0}; j != 4; ++j) {
-            const std::uint8_t color {colorRom[paletteRom[j + (i * 4)] & 0x0F]};
-            std::uint8_t r {static_cast<uint8_t>(
-                                    (((color >> 0U) & 0b1) * 0x21)
-                                    + (((color >> 1U) & 0b1) * 0x47)
-                                    + (((color >> 2U) & 0b1) * 0x97))};
-            std::uint8_t g {static_cast<uint8_t>(
-                                    (((color >> 3U) & 0b1) * 0x21)
-                                    + (((color >> 4U) & 0b1) * 0x47)
-                                    + (((color >> 5U) & 0b1) * 0x97))};
-            std::uint8_t b {static_cast<uint8_t>(
-                                    (((color >> 6U) & 0b1) * 0x51)
-                                    + (((color >> 7U) & 0b1) * 0xAE))};
-            palette[j] = (0xFF << 24U) | (b << 16U) | (g << 8U) | (r << 0U);
-        }
-    }
-
-    // decode tiles
-    for (int i {0}; i != tiles.size(); ++i) {
-        Tile& tile {tiles[i]};
-
-        decodeStrip(tileRom, tile, i, 0, 8, 0, 1);
-        decodeStrip(tileRom, tile, i, 1, 8, 0, 0);
-    }
-
-    // decode sprites
-    for (int i {0}; i != sprites.size(); ++i) {
-        Sprite& sprite {sprites[i]};
-
-        decodeStrip(spriteRom, sprite, i, 0, 16, 1, 3);
-        decodeStrip(spriteRom, sprite, i, 1, 16, 1, 0);
-        decodeStrip(spriteRom, sprite, i, 2, 16, 1, 1);
-        decodeStrip(spriteRom, sprite, i, 3, 16, 1, 2);
-        decodeStrip(spriteRom, sprite, i, 4, 16, 0, 3);
-        decodeStrip(spriteRom, sprite, i, 5, 16, 0, 0);
-        decodeStrip(spriteRom, sprite, i, 6, 16, 0, 1);
-        decodeStrip(spriteRom, sprite, i, 7, 16, 0, 2);
-    }
-
-    return true;
-}
+template class BasicPacman<NullTrace>;
+template class BasicPacman<AccessTrace>;
+template class BasicPacman<Watchpoints>;
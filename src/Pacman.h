@@ -3,36 +3,130 @@
 
 
 #include <cstdint>
-#include <array>
+#include <memory>
+#include <string>
+#include <vector>
 #include "SDL.h"
 #include "z80.h"
+#include "Assets.h"
+#include "Filter.h"
+#include "GameState.h"
+#include "Profiler.h"
+#include "Sound.h"
+#include "Trace.h"
+
+#ifndef PACMAN_LOG_BAD_ACCESS
+#define PACMAN_LOG_BAD_ACCESS 1
+#endif
+
+// Everything a frame is drawn from (plain data, memcpy-able).
+struct VideoState {
+    std::uint8_t tiles[0x800]; // video and color ram
+    std::uint8_t sprites[0x10]; // sprite ram
+    std::uint8_t spritePos[0x10];
+    bool flipScreen;
+};
 
 /**
  * Pac-Man hardware for emulator: memory, i/o, video.
+ * @tparam Trace the memory tracing policy, called on every read8, write8 and output (see Trace.h)
  */
-class Pacman {
+template<class Trace>
+class BasicPacman {
 public:
-    using Z80 = z80<Pacman>;
-    using Palette = std::uint32_t[4];
-    using Tile = std::uint8_t[64];
-    using Sprite = std::uint8_t[256];
+    using Z80 = z80<BasicPacman>;
+    using Palette = Assets::Palette;
+    using Tile = Assets::Tile;
+    using Sprite = Assets::Sprite;
+
+    // input port bits (active low; IN0 and IN1 share the joystick bits)
+    static constexpr std::uint8_t up {0b00000001U};
+    static constexpr std::uint8_t left {0b00000010U};
+    static constexpr std::uint8_t right {0b00000100U};
+    static constexpr std::uint8_t down {0b00001000U};
+    static constexpr std::uint8_t rackAdvance {0b00010000U};
+    static constexpr std::uint8_t test {0b00010000U};
+    static constexpr std::uint8_t coin1 {0b00100000U};
+    static constexpr std::uint8_t onePlayer {0b00100000U};
+    static constexpr std::uint8_t coin2 {0b01000000U};
+    static constexpr std::uint8_t twoPlayer {0b01000000U};
+    static constexpr std::uint8_t credit {0b10000000U};
+
+    // IN1 << 8 | IN0 with nothing pressed (the cabinet is upright and board test is off)
+    static constexpr std::uint16_t idleInputs {0b11111111'10011111U};
+
+    // display constants
+    static constexpr int screenWidth {224};
+    static constexpr int screenHeight {288};
+    static constexpr int ramSize {0x1000};
+
+    // video timing: a 6.144 MHz pixel clock scans 384 x 264 pixels per frame (60.606 Hz), the CPU runs at half of it
+    static constexpr int pixelClock {6'144'000};
+    static constexpr int pixelsPerFrame {384 * 264};
+
+    // Everything the board holds besides the roms (plain data, memcpy-able). ram is last so deltas can skip it.
+    struct Snapshot {
+        Wsg wsg;
+        std::uint8_t spritePos[0x10];
+        std::uint8_t input0, input1;
+        std::uint8_t interruptVector;
+        bool interruptEnabled, soundEnabled, flipScreen;
+        std::uint8_t ram[ramSize];
+
+        bool operator==(const Snapshot&) const = default;
+    };
+
+    // Everything render() reads, so another board (or renderer) can draw a frame this one ran.
+    using Video = VideoState;
 
-    // Constructor (also sets the active boolean).
-    explicit Pacman(std::uint8_t ds);
+    /**
+     * Constructor (also sets the active boolean). Loads its own assets from the roms/ directory.
+     * @param ds the dip switch settings
+     * @param headless if true no window is created and present() does nothing
+     */
+    explicit BasicPacman(std::uint8_t ds, bool headless = false);
+
+    /**
+     * Constructor (also sets the active boolean).
+     * @param assets the shared roms and decoded graphics (inactive if nullptr)
+     * @param ds the dip switch settings
+     * @param headless if true no window is created and present() does nothing
+     */
+    BasicPacman(std::shared_ptr<const Assets> assets, std::uint8_t ds, bool headless = false);
+
+    // The page tables and frame buffer point into the object itself.
+    BasicPacman(const BasicPacman&) = delete;
+    BasicPacman& operator=(const BasicPacman&) = delete;
 
     /**
      * Reads a byte from the provided address (memory mapped).
      * @param addr the address to read from
      * @return the byte read
      */
-    [[nodiscard]] std::uint8_t read8(std::uint16_t addr) const;
+    [[nodiscard]] std::uint8_t read8(const std::uint16_t addr) const
+    {
+        if constexpr (Profiler::enabled) ++accesses.reads[Profiler::region(addr)];
+        const std::uint8_t* page {readPages[addr >> 8]};
+        const std::uint8_t val {page != nullptr ? page[addr & 0xFF] : readRegister(addr)};
+        trace.read(addr, val);
+        return val;
+    }
 
     /**
      * Writes an byte to the provided address (memory mapped).
      * @param addr the address to write to
      * @param val the byte to write
      */
-    void write8(std::uint16_t addr, std::uint8_t val);
+    void write8(const std::uint16_t addr, const std::uint8_t val)
+    {
+        if constexpr (Profiler::enabled) ++accesses.writes[Profiler::region(addr)];
+        std::uint8_t* page {writePages[addr >> 8]};
+        trace.write(addr, page != nullptr ? page[addr & 0xFF] : 0xFF, val);
+        if (page != nullptr)
+            page[addr & 0xFF] = val;
+        else
+            writeRegister(addr, val);
+    }
 
     // Reads a word from the address given (uses read8).
     [[nodiscard]] std::uint16_t read16(const std::uint16_t addr) const { return read8(addr + 1) << 8 | read8(addr); }
@@ -46,7 +140,7 @@ public:
      * @param port The port to read from
      * @return the byte read
      */
-    [[nodiscard]] static std::uint8_t input(const Pacman::Z80 *cpu, const std::uint8_t port) { return 0; }
+    [[nodiscard]] static std::uint8_t input(const Z80* cpu, const std::uint8_t port) { return 0; }
 
     /**
      * Output (port 0 sets interrupt vector).
@@ -54,7 +148,30 @@ public:
      * @param port The port to write to
      * @param val a byte to write
      */
-    void output(const Pacman::Z80 *cpu, const std::uint8_t port, const std::uint8_t val) { if (port == 0) interruptVector = val; }
+    void output(const Z80* cpu, const std::uint8_t port, const std::uint8_t val)
+    {
+        trace.output(port, val);
+        if (port == 0) interruptVector = val;
+    }
+
+    /**
+     * Generates sound samples from the WSG's current registers (a frame at the board's 60.606 Hz is 1584 samples).
+     * @param out where to write the samples (mono, Wsg::sampleRate)
+     * @param n the number of samples
+     */
+    void synthesize(std::int16_t* out, int n) { wsg.synthesize(assets->waveforms.data(), soundEnabled, out, n); }
+
+    // Both input ports as IN1 << 8 | IN0 (active low).
+    [[nodiscard]] std::uint16_t inputs() const { return input1 << 8 | input0; }
+
+    /**
+     * Sets both input ports. Only call between frames so runs are reproducible.
+     * @param inputs IN1 << 8 | IN0 (active low)
+     */
+    void setInputs(const std::uint16_t inputs) { input0 = inputs & 0xFF; input1 = inputs >> 8; }
+
+    // The inputs held on the keyboard, as IN1 << 8 | IN0 (the frontend applies them with setInputs each frame).
+    [[nodiscard]] std::uint16_t keyInputs() const { return keyInput1 << 8 | keyInput0; }
 
     /**
      * Call on key press.
@@ -68,52 +185,130 @@ public:
       */
     void onKeyUp(SDL_Scancode scancode);
 
-    // Draws the current contents of VRAM to the screen.
-    void draw();
+    /**
+     * Rasterizes the current contents of VRAM into the frame buffer, top to bottom a scanline at a time, with the
+     * sprites composed from a per-line list like the hardware's line buffer (turned 180 degrees when the screen is
+     * flipped). Only tiles whose video or color ram differs from the last render, and tiles under last frame's and
+     * this frame's sprites, are redrawn; the whole screen is redrawn after a flip, a restore or a frame buffer change.
+     */
+    void render();
+
+    // Uploads the frame buffer (through the filter, if any) to the window (no-op when headless).
+    void present();
+
+    /**
+     * Post-processes every presented frame, resizing the window's texture to the filter's output.
+     * @param filter the filter, which must outlive this object (none if nullptr)
+     * @return true if the texture could be created; false otherwise
+     */
+    bool setFilter(Filter* filter);
+
+    // Draws the current contents of VRAM to the screen (render + present).
+    void draw() { render(); present(); }
+
+    // The last rendered frame, screenWidth * screenHeight ABGR8888 pixels.
+    [[nodiscard]] const std::uint32_t* frame() const { return &rasterBuffer[0][0]; }
+
+    /**
+     * Renders into caller-owned memory instead of the internal frame buffer.
+     * @param buffer screenWidth * screenHeight pixels that outlive this object, or nullptr to use the internal one
+     */
+    void setFrameBuffer(std::uint32_t* buffer);
+
+    /**
+     * Copies the board's state out.
+     * @param snapshot where to write the state
+     */
+    void save(Snapshot& snapshot) const;
+
+    /**
+     * Copies the board's state in (the frame buffer is not touched until the next render).
+     * @param snapshot the state to restore
+     * @param redraw if true the next render redraws the whole screen; if false only what differs from the last render
+     *               (enough as long as the frame buffer still holds that render)
+     */
+    void restore(const Snapshot& snapshot, bool redraw = true);
+
+    /**
+     * Copies out what the next render would draw.
+     * @param video where to write the video state
+     */
+    void capture(Video& video) const;
+
+    /**
+     * Copies video state in so the next render draws it (only tiles that differ from the last render are redrawn).
+     * Meant for a board that only displays frames another one runs.
+     * @param video the video state to show
+     */
+    void show(const Video& video);
+
+    // The 4 KB of video, color, work and sprite ram (0x4000-0x4FFF).
+    [[nodiscard]] const std::uint8_t* memory() const { return ram; }
+
+    // The game's variables decoded from ram (a view, no copy).
+    [[nodiscard]] GameState state() const { return GameState{ram}; }
 
     // Cleans up SDL2 objects.
     void off();
 
     // True if Pacman has been initialized successfully; false otherwise.
     bool active {true};
+    const bool headless;
     std::uint8_t interruptVector {};
     bool interruptEnabled {false};
+
+    // Where render and present record their time, if profiling is compiled in (none if nullptr).
+    Profiler* profiler {nullptr};
+
+    // Memory accesses by region since the profiler last collected them (only counted if profiling is compiled in).
+    mutable Profiler::Accesses accesses {};
+
+    // Sees every bus access (read8 is const, so the policy is mutable).
+    mutable Trace trace {};
 private:
-    // input constants
-    static constexpr std::uint8_t up {0b00000001U};
-    static constexpr std::uint8_t left {0b00000010U};
-    static constexpr std::uint8_t right {0b00000100U};
-    static constexpr std::uint8_t down {0b00001000U};
-    static constexpr std::uint8_t rackAdvance {0b00010000U};
-    static constexpr std::uint8_t test {0b00010000U};
-    static constexpr std::uint8_t coin1 {0b00100000U};
-    static constexpr std::uint8_t onePlayer {0b00100000U};
-    static constexpr std::uint8_t coin2 {0b01000000U};
-    static constexpr std::uint8_t twoPlayer {0b01000000U};
-    static constexpr std::uint8_t credit {0b10000000U};
+    friend struct Bench; // times the private rasterizers (bench/main.cpp)
 
     // display constants
     static constexpr std::uint32_t black {0xFF000000};
-    static constexpr int screenWidth {224};
-    static constexpr int screenHeight {288};
     static constexpr int scaleFactor {3};
     static constexpr int pitch {screenWidth * sizeof(std::uint32_t)};
 
+    // log reads and writes of rom and unmapped addresses (compiled out of release builds)
+    static constexpr bool logBadAccess {PACMAN_LOG_BAD_ACCESS != 0};
+
+    // Fills the page tables: direct pointers for rom and ram pages, nullptr where a handler is needed.
+    void mapPages();
+
+    /**
+     * Reads a memory mapped register (or an unmapped address).
+     * @param addr the address to read from
+     * @return the byte read
+     */
+    [[nodiscard]] std::uint8_t readRegister(std::uint16_t addr) const;
+
     /**
-     * Draws a tile decoded from the tile rom.
-     * @param loc the byte that selects the tile from tile ram
-     * @param x the x coordinate [0,27] (tile's upper left corner)
-     * @param y the y coordinate [0,35] (tile's upper left corner)
+     * Writes a memory mapped register (or rom, or an unmapped address).
+     * @param addr the address to write to
+     * @param val the byte to write
      */
-    void drawTile(int loc, int x, int y);
+    void writeRegister(std::uint16_t addr, std::uint8_t val);
+
+    // A sprite as the line renderer draws it, in screen coordinates.
+    struct ScanSprite {
+        const std::uint32_t* pixels; // 16 rows of 16 pixels with the flip applied
+        const std::uint16_t* masks; // row opacity masks
+        int x, y; // upper left corner (may be off screen)
+    };
 
     /**
-     * Draws a sprite decoded from the sprite rom.
-     * @param loc selects the sprite from sprite ram
-     * @param x the x coordinate [0,27] (sprite's upper left corner)
-     * @param y the y coordinate [0,35] (sprite's upper left corner)
+     * Draws one row of tiles a scanline at a time: each line gets the pixels of the row's dirty tiles, then the
+     * sprites listed for that line over them, so every line of the frame buffer is written in one pass.
+     * @param ty the tile row on screen [0,35]
+     * @param columns bit tx set if tile column tx must be redrawn
+     * @param sprites this frame's 8 sprites
+     * @param lineSprites for each of the row's 8 lines, bit i set if sprite i covers it
      */
-    void drawSprite(int loc, int x, int y);
+    void drawBand(int ty, std::uint32_t columns, const ScanSprite* sprites, const std::uint8_t* lineSprites);
 
     /**
      * Initializes SDL2 objects.
@@ -121,21 +316,23 @@ private:
      */
     bool initVideo();
 
-    /**
-     * Preloads the game's tiles, sprites, colors, and palettes from their respective ROMs into a convenient format.
-     * @param dir the rom file's parent directory
-     * @return true if preload encountered no errors preloading the images; false otherwise
-     */
-    bool preload(const std::string& dir);
-
     const std::uint8_t dipswitch; // game settings
-    std::uint8_t input0 {0b10011111}, input1 {0b11111111U}; // default cabinet mode is upright and board test is off
+    std::uint8_t input0 {idleInputs & 0xFF}, input1 {idleInputs >> 8}; // default cabinet mode is upright and board test is off
+    std::uint8_t keyInput0 {input0}, keyInput1 {input1}; // keyboard state, latched into the ports between frames
     bool soundEnabled {false}, flipScreen {false};
+    Wsg wsg {};
+
+    std::vector<std::uint32_t> frameStorage; // internal frame buffer (empty when rendering into caller memory)
+    std::uint32_t (*rasterBuffer)[screenWidth] {nullptr};
 
-    std::uint32_t rasterBuffer[screenHeight][screenWidth] {};
+    // incremental rendering state
+    std::uint8_t renderedTiles[0x800] {}; // video and color ram as of the last render
+    int spriteRects[8][2] {}; // where each sprite was drawn last render (screen coordinates)
+    bool fullRedraw {true}, renderedFlip {false};
     SDL_Window* window {nullptr};
     SDL_Renderer* renderer {nullptr};
     SDL_Texture* texture {nullptr};
+    Filter* filter {nullptr};
 
     /**
      * 0x0000-0x4000: 16384 game rom
@@ -144,14 +341,23 @@ private:
      * 0x4800-0x4FEF: 2032 ram
      * 0x4FF0-0x4FFF: 16 sprite ram
      */
-    std::uint8_t rom[0x4000] {};
-    std::uint8_t ram[0x1000] {};
+    std::shared_ptr<const Assets> assets;
+    const std::uint8_t* rom {nullptr};
+    std::uint8_t ram[ramSize] {};
     std::uint8_t spritePos[0x10] {};
 
-    std::array<Palette, 32> palettes {};
-    std::array<Tile, 256> tiles {};
-    std::array<Sprite, 64> sprites {};
+    // 256-byte pages of the address space
+    const std::uint8_t* readPages[0x100] {};
+    std::uint8_t* writePages[0x100] {};
 };
 
 
+// The production board: no tracing.
+using Pacman = BasicPacman<NullTrace>;
+
+extern template class BasicPacman<NullTrace>;
+extern template class BasicPacman<AccessTrace>;
+extern template class BasicPacman<Watchpoints>;
+
+
 #endif //PACMAN_PACMAN_H
@@ -0,0 +1,139 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include "SDL.h"
+
+static constexpr const char* phaseNames[Profiler::phases] {"cpu", "raster", "filter", "upload", "present", "sleep", "run_ahead"};
+static constexpr const char* regionNames[Profiler::regions] {"rom", "video", "color", "ram", "sprite", "registers", "unmapped"};
+
+// A small stable number for the calling thread (trace viewers group events by it).
+static int threadNumber()
+{
+    static std::atomic<int> next {1};
+    thread_local const int number {next++};
+    return number;
+}
+
+Profiler::Profiler(std::string tracePath, const int summaryFrames)
+    : tracePath{std::move(tracePath)}, summaryFrames{summaryFrames} {}
+
+Profiler::~Profiler()
+{
+    if (!tracePath.empty()) writeTrace();
+}
+
+double Profiler::micros(const std::chrono::steady_clock::time_point t) const
+{
+    return std::chrono::duration<double, std::micro>{t - start}.count();
+}
+
+void Profiler::record(const Phase phase, const std::chrono::steady_clock::time_point begin,
+                      const std::chrono::steady_clock::time_point end)
+{
+    const double from {micros(begin)}, duration {micros(end) - from};
+    const int thread {threadNumber()};
+
+    std::lock_guard lock {mutex};
+    phaseTime[phase] += duration;
+    if (!tracePath.empty() and phaseEvents.size() != maxPhases)
+        phaseEvents.push_back({phase, thread, from, duration});
+}
+
+void Profiler::frame(const std::uint64_t frame, const int cycles, const int overshoot, Accesses& accesses)
+{
+    const double time {micros(std::chrono::steady_clock::now())};
+
+    std::lock_guard lock {mutex};
+    if (!tracePath.empty() and frameEvents.size() != maxFrames)
+        frameEvents.push_back({time, frame, cycles, overshoot, accesses});
+
+    if (frames == 0) firstFrame = frame;
+    ++frames;
+    this->cycles += cycles;
+    maxOvershoot = std::max(maxOvershoot, overshoot);
+    for (int i {0}; i != regions; ++i) {
+        this->accesses.reads[i] += accesses.reads[i];
+        this->accesses.writes[i] += accesses.writes[i];
+    }
+    accesses = {};
+
+    if (summaryFrames != 0 and frames == summaryFrames)
+        summarize();
+}
+
+void Profiler::miss(const std::uint64_t frame)
+{
+    const double time {micros(std::chrono::steady_clock::now())};
+
+    std::lock_guard lock {mutex};
+    if (!tracePath.empty() and missEvents.size() != maxFrames)
+        missEvents.push_back({time, frame});
+    ++misses;
+}
+
+void Profiler::summarize()
+{
+    const double n {static_cast<double>(frames)};
+
+    char line[512];
+    int length {std::snprintf(line, sizeof(line), "frames %llu-%llu: %.0f cycles/frame (max overshoot %d), %d missed; ms/frame",
+                              static_cast<unsigned long long>(firstFrame), static_cast<unsigned long long>(firstFrame + frames - 1),
+                              static_cast<double>(cycles) / n, maxOvershoot, misses)};
+    for (int i {0}; i != phases; ++i)
+        length += std::snprintf(line + length, sizeof(line) - length, " %s %.2f", phaseNames[i], phaseTime[i] / n * 1e-3);
+    SDL_Log("%s\n", line);
+
+    length = std::snprintf(line, sizeof(line), "  reads/writes per frame:");
+    for (int i {0}; i != regions; ++i) {
+        length += std::snprintf(line + length, sizeof(line) - length, " %s %.0f/%.0f", regionNames[i],
+                                static_cast<double>(accesses.reads[i]) / n, static_cast<double>(accesses.writes[i]) / n);
+    }
+    SDL_Log("%s\n", line);
+
+    frames = misses = maxOvershoot = 0;
+    cycles = 0;
+    std::fill(std::begin(phaseTime), std::end(phaseTime), 0.0);
+    accesses = {};
+}
+
+void Profiler::writeTrace() const
+{
+    std::FILE* file {std::fopen(tracePath.c_str(), "w")};
+    if (file == nullptr) {
+        SDL_Log("error: can't open file '%s'.\n", tracePath.c_str());
+        return;
+    }
+
+    // complete events for phases, counter events for everything counted per frame, instants for missed frames
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    const char* separator {""};
+    for (const PhaseEvent& e : phaseEvents) {
+        std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", separator,
+                     phaseNames[e.phase], e.thread, e.begin, e.duration);
+        separator = ",\n";
+    }
+    for (const FrameEvent& e : frameEvents) {
+        std::fprintf(file, "%s{\"name\":\"cycles\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"executed\":%d,\"overshoot\":%d}}",
+                     separator, e.time, e.cycles, e.overshoot);
+        separator = ",\n";
+        for (const bool write : {false, true}) {
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{", write ? "writes" : "reads", e.time);
+            for (int i {0}; i != regions; ++i) {
+                std::fprintf(file, "%s\"%s\":%llu", i != 0 ? "," : "", regionNames[i],
+                             static_cast<unsigned long long>(write ? e.accesses.writes[i] : e.accesses.reads[i]));
+            }
+            std::fprintf(file, "}}");
+        }
+    }
+    for (const MissEvent& e : missEvents) {
+        std::fprintf(file, "%s{\"name\":\"missed frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"ts\":%.3f}",
+                     separator, static_cast<unsigned long long>(e.frame), e.time);
+        separator = ",\n";
+    }
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+
+    if (phaseEvents.size() == maxPhases or frameEvents.size() == maxFrames or missEvents.size() == maxFrames)
+        SDL_Log("warning: the trace in '%s' was truncated.\n", tracePath.c_str());
+}
@@ -0,0 +1,159 @@
+#ifndef PACMAN_PROFILER_H
+#define PACMAN_PROFILER_H
+
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef PACMAN_PROFILE
+#define PACMAN_PROFILE 0
+#endif
+
+/**
+ * Per-frame profiling: time spent in each phase of a frame (on whichever thread runs it), cycles executed and
+ * overshot, memory accesses by region and frames that missed their budget. Prints a rolling summary and writes a
+ * Chrome trace (chrome://tracing, ui.perfetto.dev). Every hook is behind if constexpr (enabled), so a build without
+ * PACMAN_PROFILE compiles them all away.
+ */
+class Profiler {
+public:
+    static constexpr bool enabled {PACMAN_PROFILE != 0};
+
+    enum Phase : std::uint8_t { cpu, raster, filter, upload, present, sleep, runAhead, phases };
+    enum Region : std::uint8_t { rom, videoRam, colorRam, workRam, spriteRam, registers, unmapped, regions };
+
+    // Memory accesses by region (each board counts its own; read8 and write8 are hot, so no atomics).
+    struct Accesses {
+        std::uint64_t reads[regions] {};
+        std::uint64_t writes[regions] {};
+    };
+
+    /**
+     * Finds the region of an address.
+     * @param addr the address (A15 is not decoded)
+     * @return the region
+     */
+    static constexpr Region region(std::uint16_t addr)
+    {
+        addr &= 0x7FFFU;
+        if (addr < 0x4000) return rom;
+        if (addr < 0x4400) return videoRam;
+        if (addr < 0x4800) return colorRam;
+        if (addr < 0x4FF0) return workRam;
+        if (addr < 0x5000) return spriteRam;
+        if (addr < 0x5100) return registers;
+        return unmapped;
+    }
+
+    // Times a phase from construction to destruction.
+    class Scope {
+    public:
+        /**
+         * Constructor.
+         * @param profiler where to record the phase (nothing is recorded if nullptr)
+         * @param phase the phase
+         */
+        Scope(Profiler* profiler, const Phase phase) : profiler{profiler}, phase{phase}
+        {
+            if constexpr (enabled) if (profiler != nullptr) begin = std::chrono::steady_clock::now();
+        }
+
+        ~Scope() { if constexpr (enabled) if (profiler != nullptr) profiler->record(phase, begin, std::chrono::steady_clock::now()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Profiler* const profiler;
+        const Phase phase;
+        std::chrono::steady_clock::time_point begin {};
+    };
+
+    /**
+     * Constructor.
+     * @param tracePath where to write the Chrome trace when destroyed (no trace if empty)
+     * @param summaryFrames frames between summaries (no summaries if 0)
+     */
+    Profiler(std::string tracePath, int summaryFrames);
+
+    // Writes the trace.
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /**
+     * Records a phase (thread-safe).
+     * @param phase the phase
+     * @param begin when the phase started
+     * @param end when the phase ended
+     */
+    void record(Phase phase, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+    /**
+     * Records the end of an emulated frame (thread-safe) and prints a summary every summaryFrames frames.
+     * @param frame the frame number
+     * @param cycles the CPU cycles executed
+     * @param overshoot the cycles run past the frame's budget
+     * @param accesses the board's access counts, which are reset
+     */
+    void frame(std::uint64_t frame, int cycles, int overshoot, Accesses& accesses);
+
+    /**
+     * Records a frame that took longer than its time budget (thread-safe).
+     * @param frame the frame number
+     */
+    void miss(std::uint64_t frame);
+private:
+    // trace buffers stop growing at these sizes (about 40 minutes at 60 frames/s)
+    static constexpr std::size_t maxPhases {1 << 20};
+    static constexpr std::size_t maxFrames {1 << 18};
+
+    struct PhaseEvent {
+        Phase phase;
+        int thread;
+        double begin, duration; // microseconds since the profiler was created
+    };
+
+    struct FrameEvent {
+        double time;
+        std::uint64_t frame;
+        int cycles, overshoot;
+        Accesses accesses;
+    };
+
+    struct MissEvent {
+        double time;
+        std::uint64_t frame;
+    };
+
+    // Microseconds since the profiler was created.
+    [[nodiscard]] double micros(std::chrono::steady_clock::time_point t) const;
+
+    // Prints the summary of the frames since the last one and starts a new one.
+    void summarize();
+
+    // Writes the trace to tracePath.
+    void writeTrace() const;
+
+    const std::string tracePath;
+    const int summaryFrames;
+    const std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+
+    std::mutex mutex;
+    std::vector<PhaseEvent> phaseEvents;
+    std::vector<FrameEvent> frameEvents;
+    std::vector<MissEvent> missEvents;
+
+    // rolling summary
+    std::uint64_t firstFrame {0};
+    int frames {0}, misses {0}, maxOvershoot {0};
+    std::uint64_t cycles {0};
+    double phaseTime[phases] {};
+    Accesses accesses {};
+};
+
+
+#endif //PACMAN_PROFILER_H
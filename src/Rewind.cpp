@@ -0,0 +1,136 @@
+#include "Rewind.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Run-length encodes the XOR of two equally sized buffers as (skip, length, bytes...) runs: skip unchanged bytes,
+ * then XOR the next length bytes. Zero gaps shorter than a run header are folded into the literal bytes.
+ * @param a the first buffer
+ * @param b the second buffer
+ * @param sz the size of both buffers
+ * @param out where to write the encoding (at least sz * 3 / 2 + 4 bytes)
+ * @return the number of bytes written
+ */
+std::size_t encodeDelta(const std::uint8_t* a, const std::uint8_t* b, const std::size_t sz, std::uint8_t* out)
+{
+    std::size_t i {0}, n {0};
+    while (i != sz) {
+        std::size_t skip {0};
+        while (i != sz and a[i] == b[i]) {
+            ++i;
+            ++skip;
+        }
+        if (i == sz) break;
+
+        for (; skip > 0xFF; skip -= 0xFF) {
+            out[n++] = 0xFF;
+            out[n++] = 0;
+        }
+
+        const std::size_t start {i};
+        while (i != sz and i - start != 0xFF) {
+            if (a[i] == b[i] and (i + 1 == sz or a[i + 1] == b[i + 1]) and (i + 2 >= sz or a[i + 2] == b[i + 2]))
+                break;
+            ++i;
+        }
+
+        out[n++] = static_cast<std::uint8_t>(skip);
+        out[n++] = static_cast<std::uint8_t>(i - start);
+        for (std::size_t j {start}; j != i; ++j)
+            out[n++] = a[j] ^ b[j];
+    }
+    return n;
+}
+
+/**
+ * XORs an encoding made by encodeDelta into a buffer, turning one side of the pair into the other.
+ * @param in the encoding
+ * @param sz the encoding's size
+ * @param buffer the buffer to patch
+ */
+void applyDelta(const std::uint8_t* in, const std::size_t sz, std::uint8_t* buffer)
+{
+    std::size_t pos {0};
+    for (std::size_t n {0}; n != sz;) {
+        pos += in[n++];
+        for (int len {in[n++]}; len != 0; --len)
+            buffer[pos++] ^= in[n++];
+    }
+}
+
+Rewind::Rewind(const std::size_t arenaSize, const int maxFrames)
+    : arena(arenaSize), scratch(Machine::stateHeaderSize + Pacman::ramSize * 3 / 2 + 4), records(std::max(maxFrames, 1)) {}
+
+void Rewind::push(const Machine::State& state)
+{
+    if (!hasHead) {
+        head = state;
+        hasHead = true;
+        return;
+    }
+
+    // record = the previous frame's header + how its ram differs from this frame's
+    std::memcpy(scratch.data(), &head, Machine::stateHeaderSize);
+    const std::size_t size {Machine::stateHeaderSize + encodeDelta(head.hardware.ram, state.hardware.ram,
+                                                                   Pacman::ramSize,
+                                                                   scratch.data() + Machine::stateHeaderSize)};
+    head = state;
+
+    if (size > arena.size()) {
+        clear();
+        head = state;
+        hasHead = true;
+        return;
+    }
+
+    // wrap around: whatever is left past the write position is the oldest history
+    if (writePos + size > arena.size()) {
+        while (count != 0 and records[first].offset >= writePos)
+            evict();
+        writePos = 0;
+    }
+
+    while (count != 0 and (count == static_cast<int>(records.size())
+            or (records[first].offset < writePos + size and writePos < records[first].offset + records[first].size)))
+        evict();
+
+    std::memcpy(arena.data() + writePos, scratch.data(), size);
+    records[(first + count) % records.size()] = {writePos, size};
+    ++count;
+    writePos += size;
+    used += size;
+}
+
+bool Rewind::pop(Machine::State& state)
+{
+    if (count == 0) return false;
+
+    const Record& record {records[(first + count - 1) % records.size()]};
+    const std::uint8_t* data {arena.data() + record.offset};
+    applyDelta(data + Machine::stateHeaderSize, record.size - Machine::stateHeaderSize, head.hardware.ram);
+    std::memcpy(static_cast<void*>(&head), data, Machine::stateHeaderSize);
+
+    // the newest record's space is free again
+    writePos = record.offset;
+    used -= record.size;
+    --count;
+
+    state = head;
+    return true;
+}
+
+void Rewind::clear()
+{
+    first = 0;
+    count = 0;
+    writePos = 0;
+    used = 0;
+    hasHead = false;
+}
+
+void Rewind::evict()
+{
+    used -= records[first].size;
+    first = (first + 1) % static_cast<int>(records.size());
+    --count;
+}
@@ -0,0 +1,68 @@
+#ifndef PACMAN_REWIND_H
+#define PACMAN_REWIND_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Machine.h"
+
+/**
+ * Rewind history of machine states, one per frame. Only the newest state is kept whole; each older frame is a record
+ * holding that frame's non-ram state verbatim plus the XOR of its ram against the next frame's, run-length encoded so
+ * unchanged bytes cost nothing. Records live in a fixed arena allocated up front; when it fills, the oldest frames are
+ * dropped.
+ */
+class Rewind {
+public:
+    /**
+     * Constructor (allocates all memory up front).
+     * @param arenaSize bytes reserved for delta records
+     * @param maxFrames the most frames that can be stepped back
+     */
+    Rewind(std::size_t arenaSize, int maxFrames);
+
+    /**
+     * Appends the newest state.
+     * @param state the state after the latest frame
+     */
+    void push(const Machine::State& state);
+
+    /**
+     * Steps back one frame, discarding the newest state.
+     * @param state where to write the previous state
+     * @return false if there is no older state left; true otherwise
+     */
+    bool pop(Machine::State& state);
+
+    // Forgets all history.
+    void clear();
+
+    // The number of frames that can be stepped back.
+    [[nodiscard]] int frames() const { return count; }
+
+    // The number of arena bytes in use.
+    [[nodiscard]] std::size_t bytesUsed() const { return used; }
+private:
+    struct Record {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    // Drops the oldest record.
+    void evict();
+
+    std::vector<std::uint8_t> arena;
+    std::vector<std::uint8_t> scratch;
+    std::vector<Record> records; // ring of records, oldest at first
+    int first {0};
+    int count {0};
+    std::size_t writePos {0};
+    std::size_t used {0};
+
+    Machine::State head {};
+    bool hasHead {false};
+};
+
+
+#endif //PACMAN_REWIND_H
@@ -0,0 +1,187 @@
+#include "SharedFrames.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PACMAN_SHM 1
+#else
+#define PACMAN_SHM 0
+#endif
+
+static_assert(sizeof(SharedFrames::Header) == 64, "the header's layout is part of the format");
+static_assert(std::atomic_ref<std::uint8_t>::is_always_lock_free and std::atomic_ref<std::uint16_t>::is_always_lock_free
+              and std::atomic_ref<std::uint32_t>::is_always_lock_free and std::atomic_ref<std::uint64_t>::is_always_lock_free,
+              "slot data is copied with atomic accesses, which must be address free to work across processes");
+
+/**
+ * Copies into a slot with relaxed atomic stores. The sequence lock only orders these; making them atomic is what
+ * turns a reader copying at the same time into a torn copy it throws away instead of a data race.
+ * @param shared the slot's array
+ * @param src the values
+ * @param n the number of elements
+ */
+template<class T>
+static void storeShared(T* shared, const T* src, const std::size_t n)
+{
+    for (std::size_t i {0}; i != n; ++i)
+        std::atomic_ref<T>{shared[i]}.store(src[i], std::memory_order_relaxed);
+}
+
+// Copies out of a slot with relaxed atomic loads (see storeShared).
+template<class T>
+static void loadShared(T* dst, T* shared, const std::size_t n)
+{
+    for (std::size_t i {0}; i != n; ++i)
+        dst[i] = std::atomic_ref<T>{shared[i]}.load(std::memory_order_relaxed);
+}
+
+SharedFrames::SharedFrames(const std::string& name, const bool create, const int slots)
+    : name{name.starts_with('/') ? name : '/' + name}, owner{create}
+{
+#if PACMAN_SHM
+    const std::size_t slotSize {(sizeof(Slot) + 63) / 64 * 64};
+
+    if (create) {
+        // a stale object left by a crashed run would have the wrong size
+        shm_unlink(this->name.c_str());
+        const int fd {shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)};
+        if (fd == -1) {
+            SDL_Log("error: can't create shared memory '%s'.\n", this->name.c_str());
+            return;
+        }
+        size = sizeof(Header) + slotSize * static_cast<std::size_t>(std::max(slots, 1));
+        void* memory {ftruncate(fd, static_cast<off_t>(size)) == 0
+                      ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED};
+        close(fd);
+        if (memory == MAP_FAILED) {
+            SDL_Log("error: can't map shared memory '%s'.\n", this->name.c_str());
+            shm_unlink(this->name.c_str());
+            return;
+        }
+
+        // the new object is zero filled: every slot's sequence starts even, nothing published, no command
+        header = new (memory) Header{};
+        std::memcpy(header->magic, magic, sizeof(magic));
+        header->version = version;
+        header->slots = static_cast<std::uint32_t>(std::max(slots, 1));
+        header->slotSize = static_cast<std::uint32_t>(slotSize);
+        header->width = Pacman::screenWidth;
+        header->height = Pacman::screenHeight;
+        header->ramOffset = offsetof(Slot, ram);
+        header->pixelOffset = offsetof(Slot, pixels);
+        this->slots = static_cast<std::byte*>(memory) + sizeof(Header);
+        for (std::uint32_t i {0}; i != header->slots; ++i)
+            new (this->slots + i * slotSize) Slot{};
+    } else {
+        const int fd {shm_open(this->name.c_str(), O_RDWR, 0)};
+        if (fd == -1) {
+            SDL_Log("error: can't open shared memory '%s'.\n", this->name.c_str());
+            return;
+        }
+        // check the header before mapping the slots it describes
+        struct stat info {};
+        bool compatible {fstat(fd, &info) == 0 and static_cast<std::size_t>(info.st_size) >= sizeof(Header)};
+        if (compatible) {
+            void* probe {mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0)};
+            compatible = probe != MAP_FAILED;
+            if (compatible) {
+                const Header& existing {*static_cast<const Header*>(probe)};
+                compatible = std::memcmp(existing.magic, magic, sizeof(magic)) == 0 and existing.version == version
+                        and existing.slotSize == slotSize and existing.slots != 0;
+                size = sizeof(Header) + static_cast<std::size_t>(existing.slotSize) * existing.slots;
+                munmap(probe, sizeof(Header));
+            }
+        }
+        compatible = compatible and static_cast<std::size_t>(info.st_size) >= size;
+        void* memory {compatible ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED};
+        close(fd);
+        if (memory == MAP_FAILED) {
+            SDL_Log("error: '%s' is not a compatible frame export.\n", this->name.c_str());
+            return;
+        }
+        header = static_cast<Header*>(memory);
+        this->slots = static_cast<std::byte*>(memory) + sizeof(Header);
+    }
+    active = true;
+#else
+    SDL_Log("error: shared memory export needs a POSIX system.\n");
+#endif
+}
+
+SharedFrames::~SharedFrames()
+{
+#if PACMAN_SHM
+    if (header != nullptr) munmap(header, size);
+    if (owner and active) shm_unlink(name.c_str());
+#endif
+}
+
+SharedFrames::Slot& SharedFrames::slotAt(const std::uint64_t frame) const
+{
+    return *std::launder(reinterpret_cast<Slot*>(slots + frame % header->slots * header->slotSize));
+}
+
+void SharedFrames::publish(const std::uint64_t frame, const std::uint32_t* pixels, const std::uint8_t* ram,
+                           const std::uint16_t inputs)
+{
+    Slot& slot {slotAt(frame)};
+
+    // odd sequence: readers that started copying this slot will see it change and retry
+    const std::uint32_t sequence {slot.sequence.load(std::memory_order_relaxed)};
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    storeShared(&slot.inputs, &inputs, 1);
+    storeShared(&slot.frame, &frame, 1);
+    storeShared(slot.ram, ram, std::size(slot.ram));
+    storeShared(slot.pixels, pixels, std::size(slot.pixels));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    header->published.store(frame + 1, std::memory_order_release);
+}
+
+std::uint16_t SharedFrames::inputs(const std::uint16_t keys) const
+{
+    const std::uint32_t command {header->command.load(std::memory_order_acquire)};
+    return (command & commandValid) != 0 ? static_cast<std::uint16_t>(command) : keys;
+}
+
+bool SharedFrames::read(Slot& out) const
+{
+    for (int attempt {0}; attempt != readAttempts; ++attempt) {
+        const std::uint64_t published {header->published.load(std::memory_order_acquire)};
+        if (published == 0) return false;
+
+        Slot& slot {slotAt(published - 1)};
+        const std::uint32_t before {slot.sequence.load(std::memory_order_acquire)};
+        if ((before & 1) != 0) continue;
+
+        loadShared(&out.inputs, &slot.inputs, 1);
+        loadShared(&out.frame, &slot.frame, 1);
+        loadShared(out.ram, slot.ram, std::size(out.ram));
+        loadShared(out.pixels, slot.pixels, std::size(out.pixels));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before and out.frame == published - 1) {
+            out.sequence.store(before, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SharedFrames::command(const std::uint16_t inputs)
+{
+    header->command.store(commandValid | inputs, std::memory_order_release);
+}
+
+void SharedFrames::release()
+{
+    header->command.store(0, std::memory_order_release);
+}
@@ -0,0 +1,117 @@
+#ifndef PACMAN_SHAREDFRAMES_H
+#define PACMAN_SHAREDFRAMES_H
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Pacman.h"
+
+/**
+ * Publishes every emulated frame, the board's ram and the inputs the frame ran with into a POSIX shared memory
+ * object, so other processes on the host can map it and read frames in place instead of scraping the window. Frames
+ * go round a ring of slots, each guarded by its own sequence lock: the emulator never waits for a reader, and a
+ * reader that was overtaken mid-copy sees the sequence change and retries. Readers can also drive the game by
+ * writing inputs into the command word, which the emulator applies from the next frame on.
+ *
+ * The same class attaches to an existing object as a reader (read() and command()), and the layout below is fixed so
+ * programs in other languages can map it directly. Slot data is copied with relaxed atomic accesses, which are plain
+ * loads and stores on common hardware, so readers in other languages can copy it plainly and rely on the sequence
+ * check. The object is created with mode 0600, so only processes running as the same user can attach.
+ */
+class SharedFrames {
+public:
+    static constexpr std::uint32_t version {1};
+    static constexpr std::uint32_t commandValid {0x10000}; // set in the command word: its low 16 bits are the inputs
+
+    // The start of the object (64 bytes).
+    struct alignas(64) Header {
+        char magic[8]; // "PACSHM\0\0"
+        std::uint32_t version;
+        std::uint32_t slots; // frame n is in slot n % slots
+        std::uint32_t slotSize; // bytes from one slot to the next (the first slot follows the header)
+        std::uint32_t width, height; // of the frame, in pixels
+        std::uint32_t ramOffset, pixelOffset; // where the ram and the pixels start in a slot
+        std::uint32_t reserved;
+        std::atomic<std::uint64_t> published; // newest published frame + 1 (0 before the first)
+        std::atomic<std::uint32_t> command; // written by readers: 0, or commandValid | IN1 << 8 | IN0 (active low)
+    };
+
+    // One frame.
+    struct Slot {
+        std::atomic<std::uint32_t> sequence; // odd while the slot is being written
+        std::uint16_t inputs; // IN1 << 8 | IN0 the frame ran with
+        std::uint16_t reserved;
+        std::uint64_t frame; // the frame's number
+        std::uint8_t ram[Pacman::ramSize]; // video, color, work and sprite ram (0x4000-0x4FFF)
+        std::uint32_t pixels[Pacman::screenWidth * Pacman::screenHeight]; // ABGR8888, row after row
+    };
+
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free and std::atomic<std::uint64_t>::is_always_lock_free,
+                  "the atomics must be address free to work across processes");
+
+    /**
+     * Constructor (also sets the active boolean).
+     * @param name the shared memory object's name, e.g. "/pacman" (a leading '/' is added if missing)
+     * @param create if true the object is created (replacing any stale one, readable by this user only) for
+     *               publishing and removed by the destructor; if false an existing object is attached to for reading
+     * @param slots how many frames the ring holds (creating only)
+     */
+    explicit SharedFrames(const std::string& name, bool create = true, int slots = 4);
+
+    // Unmaps the object, and removes its name if this created it.
+    ~SharedFrames();
+
+    SharedFrames(const SharedFrames&) = delete;
+    SharedFrames& operator=(const SharedFrames&) = delete;
+
+    /**
+     * Publishes a frame (creator only, from one thread).
+     * @param frame the frame's number
+     * @param pixels screenWidth * screenHeight pixels, e.g. Pacman::frame()
+     * @param ram the board's ram, e.g. Pacman::memory()
+     * @param inputs IN1 << 8 | IN0 the frame ran with
+     */
+    void publish(std::uint64_t frame, const std::uint32_t* pixels, const std::uint8_t* ram, std::uint16_t inputs);
+
+    /**
+     * The inputs to run the next frame with (creator only).
+     * @param keys the inputs to use if no reader has sent a command
+     * @return the inputs of the command word if it holds any, otherwise keys
+     */
+    [[nodiscard]] std::uint16_t inputs(std::uint16_t keys) const;
+
+    /**
+     * Copies out the newest published frame (readers).
+     * @param slot where to copy the frame (about 256 KB, so better not on the stack)
+     * @return false if nothing has been published yet or the writer kept overtaking the copy; true otherwise
+     */
+    bool read(Slot& slot) const;
+
+    /**
+     * Sends inputs to the emulator (readers).
+     * @param inputs IN1 << 8 | IN0 (active low)
+     */
+    void command(std::uint16_t inputs);
+
+    // Hands the inputs back to the emulator's own source (readers).
+    void release();
+
+    // True if the object was created or attached successfully; false otherwise.
+    bool active {false};
+private:
+    static constexpr char magic[8] {'P', 'A', 'C', 'S', 'H', 'M', '\0', '\0'};
+    static constexpr int readAttempts {8}; // copies of a slot tried before read gives up
+
+    [[nodiscard]] Slot& slotAt(std::uint64_t frame) const;
+
+    std::string name;
+    const bool owner;
+    Header* header {nullptr};
+    std::byte* slots {nullptr};
+    std::size_t size {0};
+};
+
+
+#endif //PACMAN_SHAREDFRAMES_H
@@ -0,0 +1,47 @@
+#include "Sound.h"
+
+/**
+ * Replaces one nibble of a register.
+ * @param reg the register
+ * @param nibble which nibble [0,4]
+ * @param val the nibble's new value
+ */
+static void setNibble(std::uint32_t& reg, const int nibble, const std::uint8_t val)
+{
+    reg = (reg & ~(0xFU << (nibble * 4))) | (static_cast<std::uint32_t>(val & 0xF) << (nibble * 4));
+}
+
+void Wsg::write(const int reg, const std::uint8_t val)
+{
+    // the accumulator/waveform half and the frequency/volume half share a layout
+    const int k {reg & 0x0F};
+    const int v {k < 6 ? 0 : k < 11 ? 1 : 2};
+    const int nibble {v == 0 ? k : v == 1 ? k - 5 : k - 10};
+    Voice& voice {voices[v]};
+
+    if (reg < 0x10) {
+        if (nibble == 5)
+            voice.waveform = val & 0x07;
+        else
+            setNibble(voice.accumulator, nibble, val);
+    } else {
+        if (nibble == 5)
+            voice.volume = val & 0x0F;
+        else
+            setNibble(voice.frequency, nibble, val);
+    }
+}
+
+void Wsg::synthesize(const Assets::Waveform* waveforms, const bool enabled, std::int16_t* out, const int n)
+{
+    for (int i {0}; i != n; ++i) {
+        int sample {0};
+        for (Voice& voice : voices) {
+            voice.accumulator = (voice.accumulator + voice.frequency) & 0xFFFFF;
+            // top 5 bits of the accumulator index the 32-sample waveform; center the 4-bit sample around 0
+            sample += (static_cast<int>(waveforms[voice.waveform][voice.accumulator >> 15] & 0x0F) - 8)
+                    * static_cast<int>(voice.volume);
+        }
+        out[i] = static_cast<std::int16_t>(enabled ? sample * 64 : 0); // |sample| <= 3 * 8 * 15
+    }
+}
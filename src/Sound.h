@@ -0,0 +1,51 @@
+#ifndef PACMAN_SOUND_H
+#define PACMAN_SOUND_H
+
+
+#include <cstdint>
+#include "Assets.h"
+
+/**
+ * Namco WSG (waveform sound generator): 3 voices, each stepping a 20-bit accumulator through one of the sound prom's
+ * 32-sample 4-bit waveforms. Clocked at 96 kHz (3.072 MHz / 32). Plain data so it can live in save states.
+ */
+class Wsg {
+public:
+    static constexpr int sampleRate {96000};
+
+    /**
+     * Writes a sound register (only the low nibble is used).
+     * 0x00-0x04: voice 1 accumulator   0x05: voice 1 waveform   0x10-0x14: voice 1 frequency   0x15: voice 1 volume
+     * 0x06-0x09: voice 2 accumulator   0x0A: voice 2 waveform   0x16-0x19: voice 2 frequency   0x1A: voice 2 volume
+     * 0x0B-0x0E: voice 3 accumulator   0x0F: voice 3 waveform   0x1B-0x1E: voice 3 frequency   0x1F: voice 3 volume
+     * (voices 2 and 3 have no lowest nibble)
+     * @param reg the register [0x00,0x1F] (address - 0x5040)
+     * @param val the byte written
+     */
+    void write(int reg, std::uint8_t val);
+
+    /**
+     * Generates samples at sampleRate, advancing the voices.
+     * @param waveforms the sound prom's waveforms
+     * @param enabled the sound enable latch (silence if false; the voices still advance)
+     * @param out where to write the samples
+     * @param n the number of samples
+     */
+    void synthesize(const Assets::Waveform* waveforms, bool enabled, std::int16_t* out, int n);
+
+    bool operator==(const Wsg&) const = default;
+private:
+    struct Voice {
+        std::uint32_t accumulator;
+        std::uint32_t frequency;
+        std::uint32_t waveform;
+        std::uint32_t volume;
+
+        bool operator==(const Voice&) const = default;
+    };
+
+    Voice voices[3] {};
+};
+
+
+#endif //PACMAN_SOUND_H
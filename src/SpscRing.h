@@ -0,0 +1,75 @@
+#ifndef PACMAN_SPSCRING_H
+#define PACMAN_SPSCRING_H
+
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+/**
+ * Wait-free single-producer single-consumer ring buffer. All storage is allocated up front; push and pop never lock,
+ * allocate or spin, so the consumer can be a real-time thread (e.g. the audio callback).
+ * @tparam T a trivially copyable element type
+ */
+template<class T>
+class SpscRing {
+public:
+    /**
+     * Constructor.
+     * @param capacity the most elements held at once (rounded up to a power of two)
+     */
+    explicit SpscRing(const std::size_t capacity) : mask{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1},
+        items{std::make_unique<T[]>(mask + 1)} {}
+
+    /**
+     * Appends elements (producer only).
+     * @param src the elements
+     * @param n the number of elements
+     * @return the number appended (fewer than n if the ring is full)
+     */
+    std::size_t push(const T* src, std::size_t n)
+    {
+        const std::size_t tail {writeIndex.load(std::memory_order_relaxed)};
+        n = std::min(n, mask + 1 - (tail - readIndex.load(std::memory_order_acquire)));
+        for (std::size_t i {0}; i != n; ++i)
+            items[(tail + i) & mask] = src[i];
+        writeIndex.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Removes elements (consumer only).
+     * @param dst where to copy the elements
+     * @param n the most elements to remove
+     * @return the number removed (fewer than n if the ring ran dry)
+     */
+    std::size_t pop(T* dst, std::size_t n)
+    {
+        const std::size_t head {readIndex.load(std::memory_order_relaxed)};
+        n = std::min(n, writeIndex.load(std::memory_order_acquire) - head);
+        for (std::size_t i {0}; i != n; ++i)
+            dst[i] = items[(head + i) & mask];
+        readIndex.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // The number of elements held (approximate while the other side is running).
+    [[nodiscard]] std::size_t size() const
+    {
+        const std::size_t head {readIndex.load(std::memory_order_acquire)}; // read first: the difference can't go negative
+        return writeIndex.load(std::memory_order_acquire) - head;
+    }
+
+    // The most elements held at once.
+    [[nodiscard]] std::size_t capacity() const { return mask + 1; }
+private:
+    const std::size_t mask;
+    const std::unique_ptr<T[]> items;
+    alignas(64) std::atomic<std::size_t> writeIndex {0};
+    alignas(64) std::atomic<std::size_t> readIndex {0};
+};
+
+
+#endif //PACMAN_SPSCRING_H
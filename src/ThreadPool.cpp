@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    threads = std::max(threads, 1U);
+    queues = std::make_unique<Queue[]>(threads);
+    workers.reserve(threads - 1);
+    for (unsigned id {0}; id != threads - 1; ++id)
+        workers.emplace_back(&ThreadPool::work, this, id);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard guard {lock};
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(const int n, const std::function<void(int)>& fn)
+{
+    if (n <= 0) return;
+
+    Job job {&fn, n};
+    const unsigned threads {size()};
+
+    // contiguous chunks per queue so neighbouring tasks stay on one core unless stolen
+    for (unsigned q {0}; q != threads; ++q) {
+        const int begin {static_cast<int>(static_cast<long long>(n) * q / threads)};
+        const int end {static_cast<int>(static_cast<long long>(n) * (q + 1) / threads)};
+        std::lock_guard guard {queues[q].lock};
+        for (int i {begin}; i != end; ++i)
+            queues[q].tasks.push_back({&job, i});
+    }
+
+    {
+        std::lock_guard guard {lock};
+        ++generation;
+    }
+    wake.notify_all();
+
+    // the caller owns the last queue
+    Task task {};
+    while (pop(threads - 1, task))
+        run(task);
+
+    std::unique_lock guard {lock};
+    done.wait(guard, [&job] { return job.remaining.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::work(const unsigned id)
+{
+    std::uint64_t seen {0};
+    for (;;) {
+        {
+            std::unique_lock guard {lock};
+            wake.wait(guard, [this, seen] { return stop or generation != seen; });
+            if (stop) return;
+            seen = generation;
+        }
+
+        Task task {};
+        while (pop(id, task))
+            run(task);
+    }
+}
+
+bool ThreadPool::pop(const unsigned id, Task& task)
+{
+    {
+        Queue& own {queues[id]};
+        std::lock_guard guard {own.lock};
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    const unsigned threads {size()};
+    for (unsigned i {1}; i != threads; ++i) {
+        Queue& victim {queues[(id + i) % threads]};
+        std::lock_guard guard {victim.lock};
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(const Task& task)
+{
+    (*task.job->fn)(task.index);
+
+    // the job lives on the caller's stack: don't touch it after the last decrement
+    if (task.job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard guard {lock};
+        done.notify_all();
+    }
+}
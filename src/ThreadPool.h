@@ -0,0 +1,77 @@
+#ifndef PACMAN_THREADPOOL_H
+#define PACMAN_THREADPOOL_H
+
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads with one task deque each. Work is split evenly across the deques; a worker that
+ * runs dry steals from the back of the others, so uneven tasks still keep every core busy.
+ */
+class ThreadPool {
+public:
+    /**
+     * Constructor.
+     * @param threads the total number of threads including the caller of parallelFor (at least 1)
+     */
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    /**
+     * Calls fn(i) for every i in [0,n) and blocks until all calls have returned. The calling thread takes part.
+     * Must not be called concurrently or from inside fn.
+     * @param n the number of tasks
+     * @param fn the task body
+     */
+    void parallelFor(int n, const std::function<void(int)>& fn);
+
+    // The total number of threads including the caller.
+    [[nodiscard]] unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+private:
+    struct Job {
+        const std::function<void(int)>* fn;
+        std::atomic<int> remaining;
+    };
+
+    struct Task {
+        Job* job;
+        int index;
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    // Worker thread body.
+    void work(unsigned id);
+
+    // Takes a task from the front of queue id, or steals one from the back of another queue.
+    bool pop(unsigned id, Task& task);
+
+    // Runs a task and signals the caller if it was the job's last.
+    void run(const Task& task);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Queue[]> queues;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::uint64_t generation {0};
+    bool stop {false};
+};
+
+
+#endif //PACMAN_THREADPOOL_H
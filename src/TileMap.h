@@ -0,0 +1,44 @@
+#ifndef PACMAN_TILEMAP_H
+#define PACMAN_TILEMAP_H
+
+
+/**
+ * Maps between tile ram offsets [0,0x3FF] and tile coordinates on screen. Offsets outside the visible area (the
+ * first and last two columns of the top and bottom rows) map to -1.
+ */
+struct TileMap {
+    int loc[36][28] {};
+    int x[0x400] {};
+    int y[0x400] {};
+
+    constexpr TileMap()
+    {
+        for (int i {0}; i != 0x400; ++i)
+            x[i] = y[i] = -1;
+
+        const auto set {[this](const int l, const int tx, const int ty) { loc[ty][tx] = l; x[l] = tx; y[l] = ty; }};
+
+        // bottom of screen
+        for (int ty {0}; ty != 2; ++ty) {
+            for (int tx {2}; tx != 30; ++tx)
+                set(tx + (ty * 32), 29 - tx, ty + 34);
+        }
+
+        // middle of screen
+        for (int tx {0}; tx != 28; ++tx) {
+            for (int ty {0}; ty != 32; ++ty)
+                set(64 + ty + (tx * 32), 27 - tx, ty + 2);
+        }
+
+        // top of screen
+        for (int ty {0}; ty != 2; ++ty) {
+            for (int tx {2}; tx != 30; ++tx)
+                set(960 + tx + (ty * 32), 29 - tx, ty);
+        }
+    }
+};
+
+inline constexpr TileMap tileMap {};
+
+
+#endif //PACMAN_TILEMAP_H
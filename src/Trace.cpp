@@ -0,0 +1,32 @@
+#include "Trace.h"
+#include <algorithm>
+#include <bit>
+#include "SDL.h"
+
+AccessTrace::AccessTrace(const std::size_t capacity)
+    : ring(std::bit_ceil(std::max<std::size_t>(capacity, 1))), mask{ring.size() - 1} {}
+
+void AccessTrace::dump(std::FILE* file) const
+{
+    static constexpr const char* kinds[] {"read", "write", "out"};
+
+    const std::uint64_t first {next > ring.size() ? next - ring.size() : 0};
+    for (std::uint64_t i {first}; i != next; ++i) {
+        const Access& access {ring[i & mask]};
+        std::fprintf(file, "%llu %s %04X %02X\n", static_cast<unsigned long long>(access.frame), kinds[access.kind],
+                     access.addr, access.val);
+    }
+}
+
+void Watchpoints::watch(const std::uint16_t addr, const int size)
+{
+    for (int i {0}; i < size; ++i)
+        watched.set((addr + i) & 0x7FFF);
+}
+
+void Watchpoints::hit(const std::uint16_t addr, const std::uint8_t before, const std::uint8_t val)
+{
+    ++hits;
+    SDL_Log("watch: frame %llu: %04X changed %02X -> %02X\n", static_cast<unsigned long long>(currentFrame),
+            addr & 0x7FFFU, before, val);
+}
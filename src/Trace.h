@@ -0,0 +1,113 @@
+#ifndef PACMAN_TRACE_H
+#define PACMAN_TRACE_H
+
+
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+ * Memory tracing policies for BasicPacman. The board calls its policy on every bus access, so a policy is a struct
+ * with these hooks (all inline, called on the emulation thread):
+ *   frame(n)                  a new frame starts (called by the machine)
+ *   read(addr, val)           the CPU read val at addr
+ *   write(addr, before, val)  the CPU wrote val at addr, which held before (0xFF for registers and rom)
+ *   output(port, val)         the CPU wrote val to an i/o port
+ */
+
+// No tracing: every hook is empty and compiles away (the production board).
+struct NullTrace {
+    void frame(std::uint64_t) {}
+    void read(std::uint16_t, std::uint8_t) {}
+    void write(std::uint16_t, std::uint8_t, std::uint8_t) {}
+    void output(std::uint8_t, std::uint8_t) {}
+};
+
+/**
+ * Keeps the most recent accesses to an address range in a ring buffer, so the lead-up to a bug can be dumped after
+ * the fact. Only ram and the registers are traced by default (rom reads are mostly opcode fetches).
+ */
+class AccessTrace {
+public:
+    enum Kind : std::uint8_t { load, store, port };
+
+    struct Access {
+        std::uint64_t frame;
+        std::uint16_t addr;
+        std::uint8_t val;
+        Kind kind;
+    };
+
+    /**
+     * Constructor.
+     * @param capacity how many accesses to keep (rounded up to a power of two)
+     */
+    explicit AccessTrace(std::size_t capacity = 1 << 16);
+
+    void frame(const std::uint64_t n) { currentFrame = n; }
+    void read(const std::uint16_t addr, const std::uint8_t val) { if (traced(addr)) push(addr, val, load); }
+    void write(const std::uint16_t addr, std::uint8_t, const std::uint8_t val) { if (traced(addr)) push(addr, val, store); }
+    void output(const std::uint8_t port, const std::uint8_t val) { push(port, val, AccessTrace::port); }
+
+    /**
+     * Writes the kept accesses, oldest first, one per line.
+     * @param file where to write
+     */
+    void dump(std::FILE* file) const;
+
+    // Accesses recorded since construction (including those overwritten since).
+    [[nodiscard]] std::uint64_t total() const { return next; }
+
+    // The traced range, inclusive (A15 is ignored).
+    std::uint16_t low {0x4000}, high {0x50FF};
+private:
+    [[nodiscard]] bool traced(const std::uint16_t addr) const
+    {
+        const std::uint16_t a {static_cast<std::uint16_t>(addr & 0x7FFFU)};
+        return low <= a and a <= high;
+    }
+
+    void push(const std::uint16_t addr, const std::uint8_t val, const Kind kind)
+    {
+        ring[next++ & mask] = {currentFrame, static_cast<std::uint16_t>(addr & 0x7FFFU), val, kind};
+    }
+
+    std::vector<Access> ring;
+    const std::size_t mask;
+    std::uint64_t next {0};
+    std::uint64_t currentFrame {0};
+};
+
+/**
+ * Logs every write that changes a watched address, with the frame it happened in.
+ */
+class Watchpoints {
+public:
+    /**
+     * Watches an address range.
+     * @param addr the first address (A15 is ignored)
+     * @param size the number of bytes
+     */
+    void watch(std::uint16_t addr, int size = 1);
+
+    void frame(const std::uint64_t n) { currentFrame = n; }
+    void read(std::uint16_t, std::uint8_t) {}
+    void write(const std::uint16_t addr, const std::uint8_t before, const std::uint8_t val)
+    {
+        if (before != val and watched.test(addr & 0x7FFFU)) hit(addr, before, val);
+    }
+    void output(std::uint8_t, std::uint8_t) {}
+
+    // Watched writes that changed their address since construction.
+    std::uint64_t hits {0};
+private:
+    // Logs a change (kept out of line, it is the rare case).
+    void hit(std::uint16_t addr, std::uint8_t before, std::uint8_t val);
+
+    std::bitset<0x8000> watched;
+    std::uint64_t currentFrame {0};
+};
+
+
+#endif //PACMAN_TRACE_H
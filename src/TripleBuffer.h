@@ -0,0 +1,46 @@
+#ifndef PACMAN_TRIPLEBUFFER_H
+#define PACMAN_TRIPLEBUFFER_H
+
+
+#include <atomic>
+
+/**
+ * Lock-free single-producer single-consumer triple buffer. The producer fills back() and publishes it; the consumer
+ * picks up the newest published value with update() and reads front(). Neither side ever waits for the other and
+ * values the consumer was too slow to see are simply replaced.
+ * @tparam T the value type
+ */
+template<class T>
+class TripleBuffer {
+public:
+    // The value being filled (producer only).
+    T& back() { return buffers[backIndex]; }
+
+    // Makes back() the newest value and hands the producer another buffer to fill (producer only).
+    void publish() { backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & index; }
+
+    /**
+     * Swaps the newest published value into front() (consumer only).
+     * @return true if front() changed; false if nothing was published since the last update
+     */
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & fresh) == 0) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & index;
+        return true;
+    }
+
+    // The newest value as of the last update (consumer only).
+    [[nodiscard]] const T& front() const { return buffers[frontIndex]; }
+private:
+    // middle holds the index of the buffer between the two sides plus a flag set when it holds an unseen value
+    static constexpr int index {0b011};
+    static constexpr int fresh {0b100};
+
+    T buffers[3] {};
+    int backIndex {0}, frontIndex {1};
+    std::atomic<int> middle {2};
+};
+
+
+#endif //PACMAN_TRIPLEBUFFER_H
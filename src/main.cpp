@@ -1,20 +1,155 @@
+#include <chrono>
 #include "SDL.h"
-#include "z80.h"
-#include "Pacman.h"
+#include "Batch.h"
+#include "Frontend.h"
+#include "Machine.h"
+#include "Hash.h"
+#include "Movie.h"
+#include "Netplay.h"
 
-using Z80 = z80<Pacman>;
+/**
+ * Replays a movie headless at maximum speed, checking every ram checkpoint. Stops at the first one that diverges.
+ * @param movie the movie
+ * @param machine a freshly constructed machine with the movie's dip switches
+ * @return true if the replay matched every checkpoint; false otherwise
+ */
+template<class Trace>
+bool replay(MovieReader& movie, BasicMachine<Trace>& machine)
+{
+    std::uint64_t frames {0}, checkpoints {0}, diverged {0};
+    std::uint16_t inputs {};
+    const auto begin {std::chrono::steady_clock::now()};
+    while (diverged == 0 and movie.next(inputs)) {
+        machine.runFrame(inputs);
+        ++frames;
 
-int main(int argc, char** argv)
+        std::uint64_t hash {};
+        if (movie.checkpoint(frames, hash)) {
+            ++checkpoints;
+            if (hash != hash64(machine.pacman.memory(), Pacman::ramSize))
+                diverged = frames;
+        }
+    }
+    const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - begin};
+
+    SDL_Log("replayed %llu frames in %.3f s (%.0f frames/s)\n",
+            static_cast<unsigned long long>(frames), elapsed.count(), static_cast<double>(frames) / elapsed.count());
+    if (diverged != 0) {
+        SDL_Log("replay diverged: ram differs from the recording at the checkpoint after frame %llu.\n",
+                static_cast<unsigned long long>(diverged));
+        return false;
+    }
+    SDL_Log("replay matched all %llu checkpoints.\n", static_cast<unsigned long long>(checkpoints));
+    return true;
+}
+
+/**
+ * Replays a movie, with memory tracing if asked for.
+ * @param path the movie file
+ * @param render if false frames are not rasterized
+ * @param idleSkip see Machine::idleSkip
+ * @param watches address ranges (first address, size) to log every change of
+ * @param accessLogPath where to write the last accesses to ram and registers when the replay ends (none if empty)
+ * @return true if the replay matched every checkpoint; false otherwise
+ */
+bool replay(const std::string& path, const bool render, const bool idleSkip,
+            const std::vector<std::pair<std::uint16_t, int>>& watches, const std::string& accessLogPath)
 {
-    // initialize SDL2
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        SDL_Log("SDL_Init() failed. SDL_Error: %s\n", SDL_GetError());
-        return 0;
+    MovieReader movie {path};
+    if (!movie.active) return false;
+
+    const std::shared_ptr<const Assets> assets {Assets::load("roms/")};
+    if (assets == nullptr) return false;
+
+    const MovieHeader expected {MovieHeader::make(*assets, movie.header.dipswitch, movie.header.checkpointInterval)};
+    if (expected.romHash != movie.header.romHash or expected.graphicsHash != movie.header.graphicsHash)
+        SDL_Log("warning: movie '%s' was recorded with different roms.\n", path.c_str());
+
+    if (idleSkip and (!accessLogPath.empty() or !watches.empty()))
+        SDL_Log("warning: -idle_skip is ignored by traced replays, they count every access.\n");
+
+    const auto run {[&](auto& machine) {
+        machine.render = render;
+        machine.idleSkip = idleSkip;
+        return replay(movie, machine);
+    }};
+
+    if (!accessLogPath.empty()) {
+        BasicMachine<AccessTrace> machine {assets, movie.header.dipswitch, true};
+        const bool matched {run(machine)};
+        if (std::FILE* file {std::fopen(accessLogPath.c_str(), "w")}) {
+            machine.pacman.trace.dump(file);
+            std::fclose(file);
+        } else {
+            SDL_Log("error: can't open file '%s'.\n", accessLogPath.c_str());
+        }
+        return matched;
+    }
+
+    if (!watches.empty()) {
+        BasicMachine<Watchpoints> machine {assets, movie.header.dipswitch, true};
+        for (const auto& [addr, size] : watches)
+            machine.pacman.trace.watch(addr, size);
+        const bool matched {run(machine)};
+        SDL_Log("%llu watched writes changed memory.\n", static_cast<unsigned long long>(machine.pacman.trace.hits));
+        return matched;
     }
 
-    static constexpr int clockSpeed {static_cast<int>(3.072e6)}; // 3.072 MHz
-    static constexpr int cyclesPerFrame {clockSpeed / 60};
-    const int frameTime {static_cast<int>(1.0 / 60.0 * 1e3)};
+    Machine machine {assets, movie.header.dipswitch, true};
+    return run(machine);
+}
+
+int main(int argc, char** argv)
+{
+    // headless mode: run this many frames as fast as possible then exit
+    int headlessFrames {0};
+    int headlessInstances {1};
+    bool headlessRender {true};
+    bool idleSkip {true};
+    bool sound {true};
+
+    // seconds of rewind history (hold backspace to rewind)
+    int rewindSeconds {30};
+
+    // frames per tick, normally and while tab is held; drop frames rather than slow down
+    int speed {1}, turboSpeed {4};
+    bool frameSkip {true};
+
+    // frames the window shows ahead of the game, with the keys held now (off if 0)
+    int runAhead {0};
+
+    // input movies
+    std::string recordPath, replayPath;
+    int checkpointInterval {60};
+
+    // stream every frame to a file or pipe
+    std::string capturePath;
+    Capture::Format captureFormat {Capture::y4m};
+
+    // publish frames to other processes through shared memory (none if empty)
+    std::string shareName;
+
+    // two player netplay: wait for a peer on a port, or join one at host:port (off if neither)
+    bool netplayOn {false};
+    Netplay::Options netplayOptions {};
+
+    // lookahead autoplay: frames simulated per direction at each decision (off if 0)
+    int autoplayHorizon {0};
+
+    // memory tracing of replays: address ranges to watch, file to dump the last accesses to
+    std::vector<std::pair<std::uint16_t, int>> watches;
+    std::string accessLogPath;
+
+    // post-process the window's frames on the CPU (0 threads: every core but the emulator's)
+    Filter::Kind filterKind {Filter::none};
+    int filterThreads {0};
+
+    // write the decoded roms to a single asset pack and exit
+    std::string packPath;
+
+    // profiling (needs a build with PACMAN_PROFILE)
+    std::string tracePath;
+    int profileFrames {0};
 
     // dipswitch command line parsing
     std::uint8_t dipswitch {0b11001001};
@@ -81,46 +216,338 @@ int main(int argc, char** argv)
                 if (setting != "NORMAL")
                     SDL_Log("error: failed to read integer for '-ghost_names' parameter, using default=normal.\n");
             }
+        } else if (argv[i] == "-headless"sv) {
+            try {
+                headlessFrames = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-headless' parameter, using default=windowed.\n");
+            }
+        } else if (argv[i] == "-instances"sv) {
+            try {
+                headlessInstances = std::max(1, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-instances' parameter, using default=1.\n");
+            }
+        } else if (argv[i] == "-rewind"sv) {
+            try {
+                rewindSeconds = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-rewind' parameter, using default=30 seconds.\n");
+            }
+        } else if (argv[i] == "-speed"sv) {
+            try {
+                speed = std::max(1, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-speed' parameter, using default=1.\n");
+            }
+        } else if (argv[i] == "-turbo"sv) {
+            try {
+                turboSpeed = std::max(1, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-turbo' parameter, using default=4.\n");
+            }
+        } else if (argv[i] == "-frame_skip"sv) {
+            frameSkip = setting != "OFF";
+            if (setting != "ON" and setting != "OFF")
+                SDL_Log("error: failed to read '-frame_skip' parameter, using default=on.\n");
+        } else if (argv[i] == "-run_ahead"sv) {
+            try {
+                runAhead = std::clamp(std::stoi(setting), 0, Frontend::maxRunAhead);
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-run_ahead' parameter, using default=0 (off).\n");
+            }
+        } else if (argv[i] == "-idle_skip"sv) {
+            idleSkip = setting != "OFF";
+            if (setting != "ON" and setting != "OFF")
+                SDL_Log("error: failed to read '-idle_skip' parameter, using default=on.\n");
+        } else if (argv[i] == "-record"sv) {
+            recordPath = setting;
+        } else if (argv[i] == "-replay"sv) {
+            replayPath = setting;
+        } else if (argv[i] == "-checkpoint"sv) {
+            try {
+                checkpointInterval = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-checkpoint' parameter, using default=60 frames.\n");
+            }
+        } else if (argv[i] == "-sound"sv) {
+            sound = setting != "OFF";
+            if (setting != "ON" and setting != "OFF")
+                SDL_Log("error: failed to read '-sound' parameter, using default=on.\n");
+        } else if (argv[i] == "-capture"sv) {
+            capturePath = setting;
+        } else if (argv[i] == "-capture_format"sv) {
+            if (setting == "Y4M") {
+                captureFormat = Capture::y4m;
+            } else if (setting == "RGBA") {
+                captureFormat = Capture::rgba;
+            } else if (setting == "INDEXED") {
+                captureFormat = Capture::indexed;
+            } else {
+                SDL_Log("error: failed to read '-capture_format' parameter, using default=Y4M.\n");
+                captureFormat = Capture::y4m;
+            }
+        } else if (argv[i] == "-share"sv) {
+            shareName = setting;
+        } else if (argv[i] == "-net_host"sv) {
+            try {
+                netplayOptions.port = std::clamp(std::stoi(setting), 1, 0xFFFF);
+                netplayOptions.peer.clear();
+                netplayOn = true;
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-net_host' parameter, netplay is off.\n");
+            }
+        } else if (argv[i] == "-net_join"sv) {
+            netplayOptions.peer = setting;
+            netplayOptions.port = 0;
+            netplayOn = true;
+        } else if (argv[i] == "-net_delay"sv) {
+            try {
+                netplayOptions.inputDelay = std::clamp(std::stoi(setting), 0, Netplay::maxInputDelay);
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-net_delay' parameter, using default=2 frames.\n");
+            }
+        } else if (argv[i] == "-net_latency"sv) {
+            try {
+                netplayOptions.latency = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-net_latency' parameter, using default=0 ms.\n");
+            }
+        } else if (argv[i] == "-net_jitter"sv) {
+            try {
+                netplayOptions.jitter = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-net_jitter' parameter, using default=0 ms.\n");
+            }
+        } else if (argv[i] == "-net_loss"sv) {
+            try {
+                netplayOptions.loss = std::clamp(std::stoi(setting), 0, 100);
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-net_loss' parameter, using default=0%%.\n");
+            }
+        } else if (argv[i] == "-autoplay"sv) {
+            try {
+                autoplayHorizon = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-autoplay' parameter, using default=0 (off).\n");
+            }
+        } else if (argv[i] == "-watch"sv) {
+            // comma separated addresses or first-last ranges, in hex
+            try {
+                for (std::size_t begin {0}; begin < setting.size();) {
+                    std::size_t end {setting.find(',', begin)};
+                    if (end == std::string::npos) end = setting.size();
+                    const std::string item {setting.substr(begin, end - begin)};
+                    const std::size_t dash {item.find('-')};
+                    const unsigned long first {std::stoul(item.substr(0, dash), nullptr, 16)};
+                    const unsigned long last {dash == std::string::npos ? first : std::stoul(item.substr(dash + 1), nullptr, 16)};
+                    if (first > 0xFFFF or last < first or last > 0xFFFF) throw std::out_of_range {item};
+                    watches.emplace_back(static_cast<std::uint16_t>(first), static_cast<int>(last - first + 1));
+                    begin = end + 1;
+                }
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read addresses for '-watch' parameter, nothing is watched.\n");
+                watches.clear();
+            }
+        } else if (argv[i] == "-access_log"sv) {
+            accessLogPath = setting;
+        } else if (argv[i] == "-filter"sv) {
+            filterKind = Filter::kinds;
+            for (int kind {Filter::none}; kind != Filter::kinds; ++kind) {
+                if (setting == Filter::name(static_cast<Filter::Kind>(kind)))
+                    filterKind = static_cast<Filter::Kind>(kind);
+            }
+            if (filterKind == Filter::kinds) {
+                SDL_Log("error: failed to read '-filter' parameter, using default=NONE.\n");
+                filterKind = Filter::none;
+            }
+        } else if (argv[i] == "-filter_threads"sv) {
+            try {
+                filterThreads = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-filter_threads' parameter, using default=0 (automatic).\n");
+            }
+        } else if (argv[i] == "-write_pack"sv) {
+            packPath = setting;
+        } else if (argv[i] == "-trace"sv) {
+            tracePath = setting;
+        } else if (argv[i] == "-profile"sv) {
+            try {
+                profileFrames = std::max(0, std::stoi(setting));
+            } catch (std::exception& e) {
+                SDL_Log("error: failed to read integer for '-profile' parameter, using default=0 (no summary).\n");
+            }
+        } else if (argv[i] == "-render"sv) {
+            headlessRender = setting != "OFF";
+            if (setting != "ON" and setting != "OFF")
+                SDL_Log("error: failed to read '-render' parameter, using default=on.\n");
         } else {
-            SDL_Log("Unrecognized command line argument '%s'.\nAvailable parameters are:\n\t-coins_per_game <0,1,2,3>\n\t-lives_per_game <1,2,3,5>\n\t-extra_life_score <10000,15000,20000,0>\n\t-difficulty <NORMAL,HARD>\n\t-ghost_names <NORMAL,ALT>\n\n", argv[i]);
+            SDL_Log("Unrecognized command line argument '%s'.\nAvailable parameters are:\n\t-coins_per_game <0,1,2,3>\n\t-lives_per_game <1,2,3,5>\n\t-extra_life_score <10000,15000,20000,0>\n\t-difficulty <NORMAL,HARD>\n\t-ghost_names <NORMAL,ALT>\n\t-headless <frames>\n\t-instances <n>\n\t-render <ON,OFF>\n\t-rewind <seconds>\n\t-speed <n>\n\t-turbo <n>\n\t-frame_skip <ON,OFF>\n\t-run_ahead <frames>\n\t-idle_skip <ON,OFF>\n\t-record <file>\n\t-replay <file>\n\t-checkpoint <frames>\n\t-sound <ON,OFF>\n\t-trace <file>\n\t-profile <frames>\n\t-write_pack <file>\n\t-capture <file or |command>\n\t-capture_format <Y4M,RGBA,INDEXED>\n\t-filter <NONE,SCALE2X,SCALE3X,SCANLINES,CRT>\n\t-filter_threads <n>\n\t-share <name>\n\t-net_host <port>\n\t-net_join <host:port>\n\t-net_delay <frames>\n\t-net_latency <ms>\n\t-net_jitter <ms>\n\t-net_loss <percent>\n\t-autoplay <frames>\n\t-watch <addr[-addr],...>\n\t-access_log <file>\n\n", argv[i]);
         }
         ++i;
     }
 
-    Pacman pacman {dipswitch};
-    Z80 z {pacman};
+    if (!packPath.empty()) {
+        const std::shared_ptr<const Assets> assets {Assets::load("roms/")};
+        const bool written {assets != nullptr and assets->writePack(packPath)};
+        SDL_Quit();
+        return written ? 0 : 1;
+    }
 
-    bool quit {!(pacman.active)};
-    int cycles {cyclesPerFrame};
+    if (!replayPath.empty()) {
+        const bool matched {replay(replayPath, headlessRender, idleSkip, watches, accessLogPath)};
+        SDL_Quit();
+        return matched ? 0 : 1;
+    }
 
-    while(!quit) {
-        // process SDL events
-        SDL_Event e;
-        while (SDL_PollEvent(&e) != 0) {
-            if (e.type == SDL_QUIT) {
-                quit = true;
-            } else if (e.type == SDL_KEYDOWN) {
-                pacman.onKeyDown(e.key.keysym.scancode);
-            } else if (e.type == SDL_KEYUP) {
-                pacman.onKeyUp(e.key.keysym.scancode);
-            }
+    const bool headless {headlessFrames != 0};
+
+    // initialize SDL2 (no subsystems needed when headless)
+    if (SDL_Init(headless ? 0 : SDL_INIT_VIDEO | (sound ? SDL_INIT_AUDIO : 0)) < 0) {
+        SDL_Log("SDL_Init() failed. SDL_Error: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    // several headless instances are stepped together across every core
+    if (headless and headlessInstances > 1) {
+        // the batch only steps and renders its boards
+        if (autoplayHorizon != 0) SDL_Log("autoplay is disabled with several instances.\n");
+        if (!recordPath.empty()) SDL_Log("recording is disabled with several instances.\n");
+        if (!capturePath.empty()) SDL_Log("capture is disabled with several instances.\n");
+        if (!shareName.empty()) SDL_Log("shared memory export is disabled with several instances.\n");
+        if (netplayOn) SDL_Log("netplay is disabled with several instances.\n");
+        if (!tracePath.empty() or profileFrames != 0) SDL_Log("profiling is disabled with several instances.\n");
+
+        Batch batch {headlessInstances, dipswitch};
+        if (batch.active) {
+            batch.setRender(headlessRender);
+            batch.setIdleSkip(idleSkip);
+
+            const auto begin {std::chrono::steady_clock::now()};
+            for (int i {0}; i != headlessFrames; ++i)
+                batch.step();
+            const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - begin};
+
+            const double total {static_cast<double>(headlessFrames) * headlessInstances};
+            SDL_Log("ran %d frames on %d instances in %.3f s (%.0f frames/s)\n",
+                    headlessFrames, headlessInstances, elapsed.count(), total / elapsed.count());
         }
+        SDL_Quit();
+        return 0;
+    }
 
-        unsigned long long begin {SDL_GetTicks64()};
-        cycles = cyclesPerFrame + z.run(cycles); // z.run -> a negative value representing the number of exceeded cycles
+    const std::shared_ptr<const Assets> assets {Assets::load("roms/")};
 
-        // draw a frame
-        pacman.draw();
+    std::unique_ptr<Profiler> profiler;
+    if (!tracePath.empty() or profileFrames != 0) {
+        if constexpr (Profiler::enabled)
+            profiler = std::make_unique<Profiler>(tracePath, profileFrames);
+        else
+            SDL_Log("warning: profiling is compiled out, configure with -DPACMAN_PROFILE=ON to use it.\n");
+    }
+
+    std::unique_ptr<Capture> capture;
+    if (!capturePath.empty() and assets != nullptr) {
+        capture = std::make_unique<Capture>(capturePath, captureFormat, *assets);
+        if (!capture->active) capture.reset();
+    }
+
+    std::unique_ptr<SharedFrames> share;
+    if (!shareName.empty()) {
+        share = std::make_unique<SharedFrames>(shareName);
+        if (!share->active) share.reset();
+    }
 
-        // generate interrupt if enabled
-        if (pacman.interruptEnabled)
-            z.reqInt(pacman.interruptVector);
+    std::unique_ptr<Autoplayer> autoplayer;
+    if (autoplayHorizon != 0 and assets != nullptr) {
+        autoplayer = std::make_unique<Autoplayer>(assets, dipswitch, autoplayHorizon);
+        if (!autoplayer->active) autoplayer.reset();
+    }
 
-        // sleep until the next frame accounting for spent time
-        SDL_Delay(std::max(0LL, frameTime - static_cast<long long>(SDL_GetTicks64() - begin)));
+    std::unique_ptr<Netplay> netplay;
+    if (netplayOn and assets != nullptr) {
+        netplay = std::make_unique<Netplay>(*assets, dipswitch, netplayOptions);
+        if (!netplay->active or !netplay->connect(std::chrono::seconds{30})) netplay.reset();
     }
 
-    pacman.off();
+    if (headless) {
+        Machine machine {assets, dipswitch};
+        Pacman& pacman {machine.pacman};
+        machine.idleSkip = idleSkip;
+        pacman.profiler = profiler.get();
+
+        // rollbacks rerun frames the movie would already hold with predicted inputs (as in the frontend)
+        if (netplay and !recordPath.empty()) {
+            SDL_Log("recording is disabled during netplay.\n");
+            recordPath.clear();
+        }
+
+        std::unique_ptr<MovieWriter> movie;
+        if (!recordPath.empty() and pacman.active) {
+            movie = std::make_unique<MovieWriter>(recordPath, MovieHeader::make(*assets, dipswitch, checkpointInterval));
+            if (!movie->active) movie.reset();
+        }
+
+        if (pacman.active) {
+            machine.render = headlessRender or capture != nullptr or share != nullptr;
+
+            const auto begin {std::chrono::steady_clock::now()};
+            for (int i {0}; i != headlessFrames; ++i) {
+                if (netplay) {
+                    // the peer sets the pace: wait whenever it has fallen behind
+                    const std::uint16_t keys {autoplayer ? autoplayer->next(machine) : pacman.keyInputs()};
+                    while (!netplay->advance(machine, keys))
+                        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                } else if (autoplayer)
+                    machine.runFrame(autoplayer->next(machine));
+                else if (share)
+                    machine.runFrame(share->inputs(pacman.keyInputs()));
+                else
+                    machine.runFrame();
+                if (movie) movie->frame(pacman.inputs(), pacman.memory());
+                if (capture) capture->frame(pacman.frame(), true);
+                if (share) share->publish(machine.frameCount, pacman.frame(), pacman.memory(), pacman.inputs());
+            }
+            const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - begin};
+
+            SDL_Log("ran %d frames in %.3f s (%.0f frames/s, %.1f%% of cycles skipped idle)\n",
+                    headlessFrames, elapsed.count(), headlessFrames / elapsed.count(),
+                    100.0 * static_cast<double>(machine.skippedCycles) / (static_cast<double>(headlessFrames) * Machine::cyclesPerFrame));
+            if (autoplayer) {
+                const GameState game {pacman.state()};
+                SDL_Log("autoplay: %llu decisions, %llu frames simulated (%.0f frames/s), score %u, high score %u, board %d\n",
+                        static_cast<unsigned long long>(autoplayer->decisions),
+                        static_cast<unsigned long long>(autoplayer->rolloutFrames),
+                        static_cast<double>(autoplayer->rolloutFrames) / elapsed.count(),
+                        game.score(), game.highScore(), game.level() + 1);
+            }
+            if (netplay) {
+                netplay->finish(machine, std::chrono::seconds{5});
+                SDL_Log("netplay: %llu frames, %llu rollbacks, %llu frames resimulated, %llu stalls, %llu desyncs, ram hash %016llx\n",
+                        static_cast<unsigned long long>(machine.frameCount), static_cast<unsigned long long>(netplay->rollbacks),
+                        static_cast<unsigned long long>(netplay->resimulatedFrames),
+                        static_cast<unsigned long long>(netplay->stalls),
+                        static_cast<unsigned long long>(netplay->desyncs),
+                        static_cast<unsigned long long>(hash64(pacman.memory(), Pacman::ramSize)));
+            }
+        }
+        SDL_Quit();
+        return 0;
+    }
+
+    std::unique_ptr<Filter> filter;
+    if (filterKind != Filter::none) {
+        const unsigned cores {std::max(std::thread::hardware_concurrency(), 2U)};
+        const unsigned threads {filterThreads != 0 ? static_cast<unsigned>(filterThreads) : cores - 1};
+        filter = std::make_unique<Filter>(filterKind, Pacman::screenWidth, Pacman::screenHeight, threads);
+    }
+
+    // emulation runs on its own thread, this one handles the window
+    Frontend frontend {assets, {dipswitch, idleSkip, sound, rewindSeconds, recordPath, checkpointInterval, profiler.get(),
+                                capture.get(), filter.get(), autoplayer.get(), share.get(), speed, turboSpeed, frameSkip,
+                                runAhead, netplay.get()}};
+    if (frontend.active) frontend.run();
+
     SDL_Quit();
     return 0;
 }
@@ -0,0 +1,24 @@
+#ifndef PACMAN_CHECK_H
+#define PACMAN_CHECK_H
+
+
+#include <cstdio>
+
+// Every test is a program that checks conditions, prints the ones that fail and returns non-zero if any did.
+
+// The number of failed checks so far.
+inline int& failures()
+{
+    static int count {0};
+    return count;
+}
+
+#define CHECK(condition) \
+    ((condition) ? void() : (std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition), \
+                             void(++failures())))
+
+// Exit code ctest reports as skipped (e.g. no roms to run the game with).
+constexpr int skipped {77};
+
+
+#endif //PACMAN_CHECK_H
@@ -0,0 +1,65 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "Assets.h"
+#include "Check.h"
+
+/**
+ * Flips one byte of a file in place.
+ * @param path the file
+ * @param offset the byte to flip
+ */
+static void flipByte(const std::string& path, const std::streamoff offset)
+{
+    std::fstream file {path, std::ios::binary | std::ios::in | std::ios::out};
+    char byte {};
+    file.seekg(offset);
+    file.get(byte);
+    file.seekp(offset);
+    file.put(static_cast<char>(~byte));
+}
+
+int main(int argc, char* argv[])
+{
+    // from the rom files, so a pack already in the directory can't stand in for them
+    const std::shared_ptr<const Assets> assets {Assets::loadRoms(argc > 1 ? argv[1] : "roms/")};
+    if (assets == nullptr) return skipped;
+
+    const std::string path {(std::filesystem::temp_directory_path() / "pacman_test.pack").string()};
+    CHECK(assets->writePack(path));
+
+    // the pack gives back the same bytes
+    {
+        const std::shared_ptr<const Assets> loaded {Assets::loadPack(path, assets->romHash)};
+        CHECK(loaded != nullptr);
+        if (loaded != nullptr) {
+            CHECK(std::memcmp(static_cast<const DecodedAssets*>(loaded.get()),
+                    static_cast<const DecodedAssets*>(assets.get()), sizeof(DecodedAssets)) == 0);
+            CHECK(loaded->romHash == assets->romHash);
+            CHECK(loaded->cache != nullptr);
+        }
+    }
+
+    // made from other roms
+    CHECK(Assets::loadPack(path, assets->romHash + 1) == nullptr);
+
+    // a corrupt byte in the data
+    const auto size {static_cast<std::streamoff>(std::filesystem::file_size(path))};
+    flipByte(path, size - 1);
+    CHECK(Assets::loadPack(path, assets->romHash) == nullptr);
+    flipByte(path, size - 1);
+    CHECK(Assets::loadPack(path, assets->romHash) != nullptr);
+
+    // truncated, or with trailing bytes
+    std::filesystem::resize_file(path, static_cast<std::uintmax_t>(size - 1));
+    CHECK(Assets::loadPack(path, assets->romHash) == nullptr);
+    std::filesystem::resize_file(path, static_cast<std::uintmax_t>(size + 1));
+    CHECK(Assets::loadPack(path, assets->romHash) == nullptr);
+
+    std::filesystem::remove(path);
+
+    // no pack
+    CHECK(Assets::loadPack(path, assets->romHash) == nullptr);
+
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Check.h"
+#include "Filter.h"
+
+/**
+ * The filters written pixel by pixel from their definitions, for comparing with the vectorized rows.
+ */
+class Reference {
+public:
+    Reference(const std::vector<std::uint32_t>& frame, const int width, const int height)
+        : frame{frame}, width{width}, height{height} {}
+
+    /**
+     * Gets an output pixel.
+     * @param kind the filter
+     * @param x the output column
+     * @param y the output row
+     * @return the pixel
+     */
+    [[nodiscard]] std::uint32_t at(const Filter::Kind kind, const int x, const int y) const
+    {
+        switch (kind) {
+            case Filter::scale2x: return scale2x(x / 2, y / 2, x % 2, y % 2);
+            case Filter::scale3x: return scale3x(x / 3, y / 3, x % 3, y % 3);
+            case Filter::scanlines: return scanline(x, y, 0xFFFFFFFF);
+            case Filter::crt: return scanline(x, y, 0xFF000000 | 0xFFU << 8 * (x % 3));
+            default: return source(x, y);
+        }
+    }
+private:
+    // A source pixel, with the coordinates clamped to the frame.
+    [[nodiscard]] std::uint32_t source(const int x, const int y) const
+    {
+        return frame[std::clamp(y, 0, height - 1) * width + std::clamp(x, 0, width - 1)];
+    }
+
+    [[nodiscard]] std::uint32_t scale2x(const int x, const int y, const int i, const int j) const
+    {
+        const std::uint32_t a {source(x, y - 1)}, b {source(x + 1, y)}, c {source(x - 1, y)}, d {source(x, y + 1)};
+        const std::uint32_t p {source(x, y)};
+        if (i == 0 and j == 0) return c == a and c != d and a != b ? a : p;
+        if (i == 1 and j == 0) return a == b and a != c and b != d ? b : p;
+        if (i == 0 and j == 1) return d == c and d != b and c != a ? c : p;
+        return b == d and b != a and d != c ? d : p;
+    }
+
+    [[nodiscard]] std::uint32_t scale3x(const int x, const int y, const int i, const int j) const
+    {
+        const std::uint32_t a {source(x - 1, y - 1)}, b {source(x, y - 1)}, c {source(x + 1, y - 1)};
+        const std::uint32_t d {source(x - 1, y)}, e {source(x, y)}, f {source(x + 1, y)};
+        const std::uint32_t g {source(x - 1, y + 1)}, h {source(x, y + 1)}, k {source(x + 1, y + 1)};
+        if (b == h or d == f) return e;
+        switch (j * 3 + i) {
+            case 0: return d == b ? d : e;
+            case 1: return (d == b and e != c) or (b == f and e != a) ? b : e;
+            case 2: return b == f ? f : e;
+            case 3: return (d == b and e != g) or (d == h and e != a) ? d : e;
+            case 5: return (b == f and e != k) or (h == f and e != c) ? f : e;
+            case 6: return d == h ? d : e;
+            case 7: return (d == h and e != k) or (h == f and e != g) ? h : e;
+            case 8: return h == f ? f : e;
+            default: return e;
+        }
+    }
+
+    // Each channel not kept is dimmed to 75%, and every third row to half of that.
+    [[nodiscard]] std::uint32_t scanline(const int x, const int y, const std::uint32_t keep) const
+    {
+        const std::uint32_t p {source(x / 3, y / 3)};
+        std::uint32_t shaded {0};
+        for (int shift {0}; shift != 32; shift += 8) {
+            const std::uint32_t channel {p >> shift & 0xFF};
+            shaded |= ((keep >> shift & 0xFF) != 0 ? channel : channel - channel / 4) << shift;
+        }
+        if (y % 3 != 2) return shaded;
+        return (shaded >> 1 & 0x7F7F7F7F) | 0xFF000000;
+    }
+
+    const std::vector<std::uint32_t>& frame;
+    const int width, height;
+};
+
+/**
+ * Checks every output pixel of a filter against the reference.
+ * @param kind the filter
+ * @param width the source width
+ * @param height the source height
+ * @param threads the filter's threads
+ * @param colors how many different colors the frame has (few make many edges)
+ */
+static void compare(const Filter::Kind kind, const int width, const int height, const unsigned threads, const std::uint32_t colors)
+{
+    std::vector<std::uint32_t> frame(static_cast<std::size_t>(width) * height);
+    std::uint32_t seed {static_cast<std::uint32_t>(kind * 7919 + width * 31 + height)};
+    for (std::uint32_t& pixel : frame) {
+        seed = seed * 1664525 + 1013904223;
+        pixel = 0xFF000000 | ((seed >> 16) % colors) * 0x00251D0B;
+    }
+
+    Filter filter {kind, width, height, threads};
+    const std::uint32_t* output {filter.apply(frame.data())};
+    const Reference reference {frame, width, height};
+    int mismatches {0};
+    for (int y {0}; y != filter.outputHeight(); ++y) {
+        for (int x {0}; x != filter.outputWidth(); ++x)
+            mismatches += output[y * filter.outputWidth() + x] != reference.at(kind, x, y);
+    }
+    CHECK(mismatches == 0);
+}
+
+int main()
+{
+    for (int kind {Filter::none}; kind != Filter::kinds; ++kind) {
+        for (const std::uint32_t colors : {2U, 5U, 256U}) {
+            // the screen, plus sizes that leave every vector loop a scalar tail
+            compare(static_cast<Filter::Kind>(kind), 224, 288, 4, colors);
+            compare(static_cast<Filter::Kind>(kind), 13, 7, 1, colors);
+            compare(static_cast<Filter::Kind>(kind), 1, 3, 2, colors);
+            compare(static_cast<Filter::Kind>(kind), 10, 1, 1, colors);
+        }
+    }
+
+    return failures() == 0 ? 0 : 1;
+}
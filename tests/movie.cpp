@@ -0,0 +1,73 @@
+#include <filesystem>
+#include <vector>
+#include "Check.h"
+#include "Hash.h"
+#include "Movie.h"
+#include "Pacman.h"
+
+/**
+ * The inputs of a made-up session: long runs, short runs and single frames.
+ * @param frame the frame number
+ * @return IN1 << 8 | IN0
+ */
+static std::uint16_t inputsAt(const int frame)
+{
+    if (frame < 300) return Pacman::idleInputs; // a run longer than a one-byte varint
+    if (frame < 400) return static_cast<std::uint16_t>(Pacman::idleInputs & ~(Pacman::up << (frame / 10 % 4)));
+    return static_cast<std::uint16_t>(frame * 0x9E37);
+}
+
+int main()
+{
+    // FNV-1a reference values
+    CHECK(hash64("", 0) == 0xCBF29CE484222325ULL);
+    CHECK(hash64("a", 1) == 0xAF63DC4C8601EC8CULL);
+
+    const std::string path {(std::filesystem::temp_directory_path() / "pacman_test.pmov").string()};
+    constexpr int frames {1000};
+    constexpr std::uint32_t interval {7};
+    const MovieHeader header {0b11001001, interval, 0x0123456789ABCDEFULL, 0xFEDCBA9876543210ULL};
+
+    // ram changes every frame, so every checkpoint hash differs
+    std::vector<std::uint8_t> ram(Pacman::ramSize);
+    std::vector<std::uint64_t> hashes;
+    {
+        MovieWriter writer {path, header};
+        CHECK(writer.active);
+        for (int frame {0}; frame != frames; ++frame) {
+            ram[frame % Pacman::ramSize] ^= static_cast<std::uint8_t>(frame | 1);
+            hashes.push_back(hash64(ram.data(), ram.size()));
+            writer.frame(inputsAt(frame), ram.data());
+        }
+    }
+
+    // the reader gives back the header, every frame's inputs and the checkpoints, then ends
+    MovieReader reader {path};
+    CHECK(reader.active);
+    CHECK(reader.header.dipswitch == header.dipswitch);
+    CHECK(reader.header.checkpointInterval == interval);
+    CHECK(reader.header.romHash == header.romHash);
+    CHECK(reader.header.graphicsHash == header.graphicsHash);
+
+    int read {0}, checkpoints {0};
+    std::uint16_t inputs {};
+    while (reader.next(inputs)) {
+        CHECK(read < frames and inputs == inputsAt(read));
+        ++read;
+
+        std::uint64_t hash {};
+        if (reader.checkpoint(static_cast<std::uint64_t>(read), hash)) {
+            CHECK(read % interval == 0 and hash == hashes[read - 1]);
+            ++checkpoints;
+        }
+    }
+    CHECK(read == frames);
+    CHECK(checkpoints == frames / static_cast<int>(interval));
+
+    std::filesystem::remove(path);
+
+    // not a movie
+    CHECK(!MovieReader{path}.active);
+
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include <cstring>
+#include <vector>
+#include "Check.h"
+#include "Rewind.h"
+
+/**
+ * A made-up state for a frame: a few ram bytes change every frame, the rest stays put.
+ * @param frame the frame number
+ * @param state where to write the state
+ */
+static void makeState(const int frame, Machine::State& state)
+{
+    state = {};
+    state.frameCount = static_cast<std::uint64_t>(frame);
+    state.cycles = frame % 77;
+    state.cpu.pc = static_cast<std::uint16_t>(frame * 3);
+    state.cpu.r = static_cast<std::uint8_t>(frame & 0x7F);
+    for (int i {0}; i != Pacman::ramSize; ++i)
+        state.hardware.ram[i] = static_cast<std::uint8_t>(i * 7);
+    for (int i {0}; i != 16; ++i)
+        state.hardware.ram[(frame * 131 + i * 257) % Pacman::ramSize] = static_cast<std::uint8_t>(frame + i);
+}
+
+// True if two states hold the same frame, cycles, registers and ram.
+static bool same(const Machine::State& a, const Machine::State& b)
+{
+    return a.frameCount == b.frameCount and a.cycles == b.cycles and a.cpu == b.cpu
+            and std::memcmp(a.hardware.ram, b.hardware.ram, Pacman::ramSize) == 0;
+}
+
+int main()
+{
+    Machine::State state {}, popped {};
+
+    // stepping back returns every pushed state, newest first
+    {
+        Rewind rewind {1 << 20, 100};
+        for (int frame {0}; frame != 100; ++frame) {
+            makeState(frame, state);
+            rewind.push(state);
+        }
+        CHECK(rewind.frames() == 99);
+        for (int frame {98}; frame >= 0; --frame) {
+            CHECK(rewind.pop(popped));
+            makeState(frame, state);
+            CHECK(same(popped, state));
+        }
+        CHECK(!rewind.pop(popped));
+        CHECK(rewind.bytesUsed() == 0);
+    }
+
+    // a small arena drops the oldest frames and keeps the rest intact, across wrap arounds
+    {
+        Rewind rewind {4096, 1000};
+        for (int frame {0}; frame != 500; ++frame) {
+            makeState(frame, state);
+            rewind.push(state);
+            CHECK(rewind.bytesUsed() <= 4096);
+        }
+        const int kept {rewind.frames()};
+        CHECK(kept > 0 and kept < 499);
+        for (int frame {498}; frame != 498 - kept; --frame) {
+            CHECK(rewind.pop(popped));
+            makeState(frame, state);
+            CHECK(same(popped, state));
+        }
+        CHECK(!rewind.pop(popped));
+    }
+
+    // the frame limit caps the history even when the arena has room
+    {
+        Rewind rewind {1 << 20, 10};
+        for (int frame {0}; frame != 50; ++frame) {
+            makeState(frame, state);
+            rewind.push(state);
+        }
+        CHECK(rewind.frames() == 10);
+    }
+
+    return failures() == 0 ? 0 : 1;
+}
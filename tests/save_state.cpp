@@ -0,0 +1,56 @@
+#include <cstring>
+#include "Check.h"
+#include "Machine.h"
+
+/**
+ * Runs two machines side by side with the same inputs.
+ * @param a a machine
+ * @param b another machine
+ * @param frames the number of frames to run
+ * @return true if they end with the same registers, cycle debt, frame count and ram
+ */
+static bool runTogether(Machine& a, Machine& b, const int frames)
+{
+    for (int i {0}; i != frames; ++i) {
+        // add a credit, start a game, then hold each direction in turn
+        std::uint16_t inputs {Pacman::idleInputs};
+        if (i == 10) inputs &= ~Pacman::credit;
+        if (i == 60) inputs &= ~(Pacman::onePlayer << 8);
+        inputs &= ~((Pacman::up | Pacman::up << 8) << i / 90 % 4);
+        a.runFrame(inputs);
+        b.runFrame(inputs);
+    }
+    return a.registers() == b.registers() and a.cycles == b.cycles and a.frameCount == b.frameCount
+            and std::memcmp(a.pacman.memory(), b.pacman.memory(), Pacman::ramSize) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    const std::shared_ptr<const Assets> assets {Assets::load(argc > 1 ? argv[1] : "roms/")};
+    if (assets == nullptr) return skipped;
+
+    Machine a {assets, 0b11001001}, b {assets, 0b11001001};
+    a.render = b.render = false;
+    a.runFrames(200);
+
+    // a state restored into another machine carries on exactly like the original
+    Machine::State state {};
+    a.save(state);
+    b.restore(state);
+    CHECK(b.registers() == a.registers());
+    CHECK(std::memcmp(a.pacman.memory(), b.pacman.memory(), Pacman::ramSize) == 0);
+    CHECK(runTogether(a, b, 900));
+
+    // restoring a machine's own older state takes it back: it replays the same frames again
+    Machine::State later {};
+    a.save(later);
+    a.restore(state);
+    b.restore(state);
+    CHECK(runTogether(a, b, 900));
+    Machine::State again {};
+    a.save(again);
+    CHECK(again.cpu == later.cpu);
+    CHECK(std::memcmp(again.hardware.ram, later.hardware.ram, Pacman::ramSize) == 0);
+
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include <cstdint>
+#include <thread>
+#include "Check.h"
+#include "SpscRing.h"
+
+int main()
+{
+    // capacity rounds up to a power of two; pushes stop when full, pops when empty, in order across the wrap
+    {
+        SpscRing<int> ring {5};
+        CHECK(ring.capacity() == 8);
+
+        int in[12] {}, out[12] {};
+        for (int i {0}; i != 12; ++i) in[i] = i + 1;
+        CHECK(ring.push(in, 6) == 6);
+        CHECK(ring.pop(out, 4) == 4);
+        CHECK(out[0] == 1 and out[3] == 4);
+        CHECK(ring.push(in + 6, 6) == 6);
+        CHECK(ring.size() == 8);
+        CHECK(ring.push(in, 1) == 0);
+        CHECK(ring.pop(out, 12) == 8);
+        for (int i {0}; i != 8; ++i) CHECK(out[i] == i + 5);
+        CHECK(ring.pop(out, 1) == 0 and ring.size() == 0);
+    }
+
+    // one thread pushes a counting sequence in uneven chunks while another pops it: nothing lost, repeated or reordered
+    {
+        constexpr std::uint32_t total {1'000'000};
+        SpscRing<std::uint32_t> ring {1024};
+        std::thread producer {[&ring] {
+            std::uint32_t chunk[97], next {0};
+            for (std::uint32_t size {1}; next != total; size = size % 97 + 1) {
+                const std::uint32_t n {std::min(size, total - next)};
+                for (std::uint32_t i {0}; i != n; ++i) chunk[i] = next + i;
+                for (std::uint32_t sent {0}; sent != n;)
+                    sent += static_cast<std::uint32_t>(ring.push(chunk + sent, n - sent));
+                next += n;
+            }
+        }};
+
+        std::uint32_t expected {0}, received[61];
+        bool ordered {true};
+        while (expected != total) {
+            const std::size_t n {ring.pop(received, std::size(received))};
+            for (std::size_t i {0}; i != n; ++i)
+                ordered &= received[i] == expected++;
+        }
+        producer.join();
+        CHECK(ordered);
+        CHECK(ring.size() == 0);
+    }
+
+    return failures() == 0 ? 0 : 1;
+}
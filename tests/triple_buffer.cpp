@@ -0,0 +1,62 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "Check.h"
+#include "TripleBuffer.h"
+
+// A value whose fields must always agree, so a torn read shows.
+struct Frame {
+    std::uint64_t number;
+    std::uint64_t copies[32];
+};
+
+int main()
+{
+    // the consumer sees the newest published value, and nothing new until the next publish
+    {
+        TripleBuffer<int> buffer;
+        CHECK(!buffer.update());
+        buffer.back() = 1;
+        buffer.publish();
+        buffer.back() = 2;
+        buffer.publish();
+        CHECK(buffer.update() and buffer.front() == 2);
+        CHECK(!buffer.update() and buffer.front() == 2);
+        buffer.back() = 3;
+        buffer.publish();
+        CHECK(buffer.update() and buffer.front() == 3);
+    }
+
+    // one thread publishes numbered frames while another reads them: every frame read is whole, and newer than the last
+    {
+        constexpr std::uint64_t total {200'000};
+        TripleBuffer<Frame> buffer;
+        std::atomic<bool> done {false};
+        std::thread producer {[&] {
+            for (std::uint64_t n {1}; n <= total; ++n) {
+                Frame& frame {buffer.back()};
+                frame.number = n;
+                for (std::uint64_t& copy : frame.copies) copy = n;
+                buffer.publish();
+            }
+            done.store(true, std::memory_order_release);
+        }};
+
+        std::uint64_t last {0};
+        bool whole {true}, increasing {true};
+        for (bool finished {false}; !finished;) {
+            finished = done.load(std::memory_order_acquire);
+            if (!buffer.update()) continue;
+            const Frame& frame {buffer.front()};
+            for (const std::uint64_t copy : frame.copies) whole &= copy == frame.number;
+            increasing &= frame.number > last;
+            last = frame.number;
+        }
+        producer.join();
+        CHECK(whole);
+        CHECK(increasing);
+        CHECK(last == total);
+    }
+
+    return failures() == 0 ? 0 : 1;
+}